@@ -5,11 +5,51 @@
 #include <primo/platform/reference++.h>
 #include <primo/platform/ustring.h>
 
+#include <algorithm>
 #include <string>
 #include <memory>
 #include <functional>
 #include <optional>
 #include <stdexcept>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <array>
+#include <type_traits>
+#include <utility>
+#include <chrono>
+#include <unordered_map>
+#include <string_view>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <coroutine>
+#include <iterator>
+#include <version>
+#include <new>
+#include <tuple>
+#include <deque>
+#include <future>
+#include <condition_variable>
+#include <cerrno>
+#include <cmath>
+#include <limits>
+#include <filesystem>
+#include <fstream>
+
+#if defined(__cpp_lib_jthread)
+#include <stop_token>
+#endif
+
+#if defined(__cpp_lib_generator)
+#include <generator>
+#endif
+
+#if defined(__cpp_lib_expected)
+#include <expected>
+#endif
 
 #ifndef TRUE
 #define TRUE 1
@@ -21,14 +61,163 @@
 
 namespace primo::avblocks::modern {
 
+namespace detail {
+
+/**
+ * Keeps caller-owned storage alive while an SDK @c MediaBuffer still points at it.
+ *
+ * Used by the zero-copy @c TMediaBuffer::attach() overloads. Each entry holds a
+ * reference to the buffer plus a type-erased handle to the storage. An entry is
+ * dropped by a sweep once the registry holds the last reference to the buffer,
+ * or once the buffer no longer points at external memory (it was re-allocated
+ * or freed).
+ *
+ * The SDK does not report when it lets go of a buffer, so release is delayed:
+ * storage outlives its last SDK reference until the next sweep. @c add() sweeps
+ * only when the registry has doubled since the previous sweep, which keeps
+ * attaching amortized O(1) while the registry stays within twice the number of
+ * buffers in flight. Call @c collect() (@c TMediaBuffer::collectAttached()) to
+ * release storage promptly.
+ */
+class TExternalStorage {
+    struct Entry {
+        primo::ref<primo::codecs::MediaBuffer> buffer;
+        std::shared_ptr<const void>            storage;
+    };
+
+    static constexpr size_t minSweepSize = 64;
+
+    std::mutex                                                  mutex_;
+    std::unordered_map<primo::codecs::MediaBuffer*, Entry>      entries_;
+    size_t                                                      sweepAt_ = minSweepSize;
+
+    void collectLocked() {
+        for (auto it = entries_.begin(); it != entries_.end(); ) {
+            auto& buffer = it->second.buffer;
+            if (buffer->retainCount() == 1 || buffer->external() == FALSE)
+                it = entries_.erase(it);
+            else
+                ++it;
+        }
+        sweepAt_ = std::max(minSweepSize, entries_.size() * 2);
+    }
+
+public:
+    /// Process-wide instance. Intentionally leaked; @c TLibrary empties it before SDK shutdown.
+    static TExternalStorage& instance() {
+        static TExternalStorage* registry = new TExternalStorage();
+        return *registry;
+    }
+
+    /// Ties @p storage to @p buffer, replacing any storage previously tied to it.
+    void add(primo::codecs::MediaBuffer* buffer, std::shared_ptr<const void> storage) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto it = entries_.find(buffer); it != entries_.end()) {
+            it->second.storage = std::move(storage);
+            return;
+        }
+
+        if (entries_.size() >= sweepAt_)
+            collectLocked();
+
+        buffer->retain();
+        entries_.emplace(buffer, Entry{ primo::ref<primo::codecs::MediaBuffer>(buffer), std::move(storage) });
+    }
+
+    /// Releases the storage of buffers the SDK no longer references.
+    /// Returns the number of attachments still alive.
+    size_t collect() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        collectLocked();
+        return entries_.size();
+    }
+
+    /// Drops the entry for @p buffer when the registry and one other owner (the
+    /// caller) hold the only references to it. Returns @c true if it was dropped.
+    bool releaseShared(primo::codecs::MediaBuffer* buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(buffer);
+        if (it == entries_.end() || buffer->retainCount() != 2)
+            return false;
+        entries_.erase(it);
+        return true;
+    }
+
+    /// Releases every entry unconditionally. Called when the last @c TLibrary is destroyed.
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        sweepAt_ = minSweepSize;
+    }
+};
+
+/**
+ * Process-wide reference count behind @c TLibrary.
+ *
+ * The first reference calls @c Library::initialize(), the last one calls
+ * @c Library::shutdown(). That way a @c TLibrary nested in a helper or a
+ * worker cannot shut the SDK down while another owner is still using it.
+ */
+class TLibraryLifetime {
+    std::mutex mutex_;
+    int32_t    count_ = 0;
+    bool       initialized_ = false;
+
+public:
+    static TLibraryLifetime& instance() {
+        static TLibraryLifetime* lifetime = new TLibraryLifetime();  // never destroyed: may be used during static teardown
+        return *lifetime;
+    }
+
+    /// Adds a reference, initializing the SDK on the first one. Returns the result of @c Library::initialize().
+    bool acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_++ == 0)
+            initialized_ = primo::avblocks::Library::initialize() == TRUE;
+        return initialized_;
+    }
+
+    /// Drops a reference, shutting the SDK down with the last one.
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ > 0 && --count_ == 0) {
+            TExternalStorage::instance().clear();
+            primo::avblocks::Library::shutdown();
+            initialized_ = false;
+        }
+    }
+
+    int32_t count() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_;
+    }
+};
+
+} // namespace detail
+
+/**
+ * RAII owner of the AVBlocks library.
+ *
+ * Instances share one process-wide reference count: the first one to be
+ * constructed initializes the SDK and the last one to be destroyed shuts it
+ * down, so nested or concurrent @c TLibrary objects (e.g. one in @c main()
+ * and one inside a @c TTranscodeFarm) are safe. The static @c initialize() /
+ * @c shutdown() mirrors bypass the count and are meant for code that manages
+ * the lifetime by hand.
+ */
 class TLibrary {
 public:
     TLibrary() {
-        primo::avblocks::Library::initialize();
+        detail::TLibraryLifetime::instance().acquire();
     }
     
     ~TLibrary() {
-        primo::avblocks::Library::shutdown();
+        detail::TLibraryLifetime::instance().release();
+    }
+
+    /// Number of live @c TLibrary instances in the process.
+    static int32_t references() {
+        return detail::TLibraryLifetime::instance().count();
     }
     
     TLibrary(const TLibrary&) = delete;
@@ -119,12 +308,165 @@ public:
         }
     }
 
+    /// Builds an error that did not originate in the SDK, e.g. an OS error
+    /// (@c ErrorFacility::SystemUnix / @c SystemWindows) raised by a wrapper helper.
+    TErrorInfo(int32_t facility, int32_t code, std::string message, std::string hint = {})
+        : facility_(facility), code_(code), message_(std::move(message)), hint_(std::move(hint)) {}
+
     int32_t            facility() const { return facility_; }
     int32_t            code()     const { return code_; }
     const std::string& message()  const { return message_; }
     const std::string& hint()     const { return hint_; }
 };
 
+/**
+ * Allocation-free error code: facility and code only.
+ *
+ * Returned by the @c std::nothrow overloads of @c TTranscoderT and by
+ * @c TTranscoderT::errorCode(). Unlike @c TErrorInfo it does not copy the
+ * message and hint strings. It is a plain value and may outlive the
+ * transcoder that produced it; for the text, call @c TTranscoderT::error()
+ * before the next call on that transcoder.
+ */
+class TErrorCode {
+    int32_t facility_ = primo::error::ErrorFacility::Success;
+    int32_t code_     = 0;
+
+public:
+    TErrorCode() = default;
+
+    TErrorCode(int32_t facility, int32_t code) : facility_(facility), code_(code) {}
+
+    /// Reads facility and code from @p error without touching its strings.
+    explicit TErrorCode(const primo::error::ErrorInfo* error) {
+        if (error) {
+            facility_ = error->facility();
+            code_     = error->code();
+        }
+    }
+
+    int32_t facility() const { return facility_; }
+    int32_t code()     const { return code_; }
+
+    /// Returns @c true when no error is set.
+    bool ok() const { return facility_ == primo::error::ErrorFacility::Success; }
+
+    /// Returns @c true for @c CodecError::EOS, the normal end of a pull loop.
+    bool isEos() const {
+        return facility_ == primo::error::ErrorFacility::Codec &&
+               code_     == primo::codecs::CodecError::EOS;
+    }
+
+    /// Returns @c true for @c CodecError::InputNeeded: a push-mode @c pull() has
+    /// nothing ready until more input is pushed. Not a failure.
+    bool needsInput() const {
+        return facility_ == primo::error::ErrorFacility::Codec &&
+               code_     == primo::codecs::CodecError::InputNeeded;
+    }
+
+    /// Returns a @c TErrorInfo with facility and code only (no message or hint).
+    TErrorInfo info() const {
+        return TErrorInfo(facility_, code_, {});
+    }
+
+    friend bool operator==(const TErrorCode& a, const TErrorCode& b) {
+        return a.facility_ == b.facility_ && a.code_ == b.code_;
+    }
+};
+
+namespace detail {
+
+/**
+ * Minimal @c std::expected stand-in used by @c TExpected when the standard
+ * library does not provide it (before C++23). Covers the subset the wrapper
+ * uses: construction from a value or @c TUnexpected, @c has_value(),
+ * @c operator bool, @c value(), @c operator* / @c ->, @c error().
+ */
+template<typename E>
+struct TUnexpectedFallback {
+    E error;
+};
+
+class TBadExpectedAccess : public std::logic_error {
+public:
+    TBadExpectedAccess() : std::logic_error("bad expected access") {}
+};
+
+template<typename T, typename E>
+class TExpectedFallback {
+    std::optional<T> value_;
+    E                error_{};
+
+public:
+    using value_type = T;
+    using error_type = E;
+
+    TExpectedFallback() : value_(std::in_place) {}
+    TExpectedFallback(T value) : value_(std::move(value)) {}
+    TExpectedFallback(TUnexpectedFallback<E> unexpected) : error_(std::move(unexpected.error)) {}
+
+    bool has_value() const noexcept { return value_.has_value(); }
+    explicit operator bool() const noexcept { return has_value(); }
+
+    T& value() & {
+        if (!value_) throw TBadExpectedAccess();
+        return *value_;
+    }
+    const T& value() const & {
+        if (!value_) throw TBadExpectedAccess();
+        return *value_;
+    }
+
+    T&       operator*()        { return *value_; }
+    const T& operator*()  const { return *value_; }
+    T*       operator->()       { return &*value_; }
+    const T* operator->() const { return &*value_; }
+
+    const E& error() const { return error_; }
+};
+
+template<typename E>
+class TExpectedFallback<void, E> {
+    bool has_ = true;
+    E    error_{};
+
+public:
+    using value_type = void;
+    using error_type = E;
+
+    TExpectedFallback() = default;
+    TExpectedFallback(TUnexpectedFallback<E> unexpected) : has_(false), error_(std::move(unexpected.error)) {}
+
+    bool has_value() const noexcept { return has_; }
+    explicit operator bool() const noexcept { return has_; }
+
+    void value() const {
+        if (!has_) throw TBadExpectedAccess();
+    }
+
+    const E& error() const { return error_; }
+};
+
+} // namespace detail
+
+/// Result type of the @c std::nothrow overloads: @c std::expected<T, TErrorCode> when
+/// available (C++23), otherwise a minimal C++20 equivalent with the same core interface.
+#if defined(__cpp_lib_expected)
+template<typename T>
+using TExpected = std::expected<T, TErrorCode>;
+
+inline std::unexpected<TErrorCode> unexpectedError(TErrorCode error) {
+    return std::unexpected<TErrorCode>(error);
+}
+#else
+template<typename T>
+using TExpected = detail::TExpectedFallback<T, TErrorCode>;
+
+inline detail::TUnexpectedFallback<TErrorCode> unexpectedError(TErrorCode error) {
+    return { error };
+}
+#endif
+
 class TAVBlocksException : public std::runtime_error {
     TErrorInfo error_;
 public:
@@ -164,15 +506,48 @@ public:
     TMediaBuffer& operator=(TMediaBuffer&&) = default;
 
     TMediaBuffer&& attach(const uint8_t* data, size_t size, bool copy = true) && {
-        buffer_->attach(const_cast<uint8_t*>(data), static_cast<int32_t>(size), copy ? TRUE : FALSE);
+        buffer_->attach(const_cast<uint8_t*>(data), checkedSize(size), copy ? TRUE : FALSE);
         return std::move(*this);
     }
 
     TMediaBuffer& attach(const uint8_t* data, size_t size, bool copy = true) & {
-        buffer_->attach(const_cast<uint8_t*>(data), static_cast<int32_t>(size), copy ? TRUE : FALSE);
+        buffer_->attach(const_cast<uint8_t*>(data), checkedSize(size), copy ? TRUE : FALSE);
+        return *this;
+    }
+
+    /// Attaches @p data without copying. @p storage is kept alive until the SDK
+    /// releases this buffer (or the buffer is re-allocated), so the caller may drop
+    /// its own handle right away. Use a @c std::shared_ptr with a custom deleter to
+    /// hand over memory from any allocator.
+    TMediaBuffer&& attach(const uint8_t* data, size_t size, std::shared_ptr<const void> storage) && {
+        attachShared(data, size, std::move(storage));
+        return std::move(*this);
+    }
+
+    TMediaBuffer& attach(const uint8_t* data, size_t size, std::shared_ptr<const void> storage) & {
+        attachShared(data, size, std::move(storage));
         return *this;
     }
 
+    /// Takes ownership of @p bytes and attaches its contents without copying.
+    TMediaBuffer&& attach(std::vector<uint8_t>&& bytes) && {
+        attachVector(std::move(bytes));
+        return std::move(*this);
+    }
+
+    TMediaBuffer& attach(std::vector<uint8_t>&& bytes) & {
+        attachVector(std::move(bytes));
+        return *this;
+    }
+
+    /// Releases the storage of zero-copy attachments the SDK no longer references.
+    /// Zero-copy @c attach() also does this, but only once the registry has grown,
+    /// so storage may outlive the SDK's last reference until then.
+    /// Returns the number of attachments still alive.
+    static size_t collectAttached() {
+        return detail::TExternalStorage::instance().collect();
+    }
+
     // -- Getters --
 
     uint8_t*    start()           const { return buffer_->start(); }
@@ -234,6 +609,104 @@ public:
     }
 
     primo::codecs::MediaBuffer* get() const { return buffer_.get(); }
+
+private:
+    /// SDK buffers are sized in @c int32_t; larger attachments would wrap negative.
+    static int32_t checkedSize(size_t size) {
+        if (size > static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+            throw std::length_error("TMediaBuffer::attach: size exceeds INT32_MAX");
+        return static_cast<int32_t>(size);
+    }
+
+    void attachShared(const uint8_t* data, size_t size, std::shared_ptr<const void> storage) {
+        buffer_->attach(const_cast<uint8_t*>(data), checkedSize(size), FALSE);
+        if (storage)
+            detail::TExternalStorage::instance().add(buffer_.get(), std::move(storage));
+    }
+
+    void attachVector(std::vector<uint8_t>&& bytes) {
+        auto storage = std::make_shared<std::vector<uint8_t>>(std::move(bytes));
+        const uint8_t* data = storage->data();
+        size_t size = storage->size();
+        attachShared(data, size, std::move(storage));
+    }
+};
+
+/**
+ * Non-owning, read-only view of a @c MediaBuffer.
+ *
+ * Unlike @c TMediaBuffer it does not retain the buffer, so creating and
+ * dropping a view costs no atomic reference-count traffic. The view is only
+ * valid while the buffer is kept alive by someone else, typically the
+ * @c TMediaSample it came from, until that sample is pulled into, pushed or
+ * reset again. Trivially copyable; pass by value.
+ */
+class TMediaBufferView {
+    primo::codecs::MediaBuffer* buffer_{};
+
+public:
+    TMediaBufferView() = default;
+
+    explicit TMediaBufferView(primo::codecs::MediaBuffer* buffer) : buffer_(buffer) {}
+
+    /// Views the buffer held by an owning wrapper.
+    TMediaBufferView(const TMediaBuffer& buffer) : buffer_(buffer.get()) {}
+
+    /// Returns @c true when the view refers to a buffer.
+    bool valid() const { return buffer_ != nullptr; }
+
+    const uint8_t* data()       const { return buffer_ ? buffer_->data()       : nullptr; }
+    int32_t        dataSize()   const { return buffer_ ? buffer_->dataSize()   : 0; }
+    int32_t        dataOffset() const { return buffer_ ? buffer_->dataOffset() : 0; }
+    int32_t        capacity()   const { return buffer_ ? buffer_->capacity()   : 0; }
+    bool           external()   const { return buffer_ && buffer_->external() == TRUE; }
+    bool           empty()      const { return dataSize() == 0; }
+
+    /// Returns the valid data range as bytes.
+    std::span<const std::byte> bytes() const {
+        if (!buffer_)
+            return {};
+        return { reinterpret_cast<const std::byte*>(buffer_->data()),
+                 static_cast<size_t>(buffer_->dataSize()) };
+    }
+
+    primo::codecs::MediaBuffer* get() const { return buffer_; }
+};
+
+/**
+ * Non-owning, read-only view of a @c MediaSample.
+ *
+ * Same lifetime rules as @c TMediaBufferView: valid while the viewed sample
+ * is alive and unchanged. Returned by @c TMediaSample::view().
+ */
+class TMediaSampleView {
+    primo::codecs::MediaSample* sample_{};
+
+public:
+    TMediaSampleView() = default;
+
+    explicit TMediaSampleView(primo::codecs::MediaSample* sample) : sample_(sample) {}
+
+    /// Returns @c true when the view refers to a sample.
+    bool valid() const { return sample_ != nullptr; }
+
+    /// Returns a non-owning view of the sample's buffer (invalid if the sample has none).
+    TMediaBufferView buffer() const {
+        return TMediaBufferView(sample_ ? sample_->buffer() : nullptr);
+    }
+
+    /// Shortcut for @c buffer().bytes().
+    std::span<const std::byte> bytes() const { return buffer().bytes(); }
+
+    double  startTime()    const { return sample_->startTime(); }
+    double  endTime()      const { return sample_->endTime(); }
+    int32_t flags()        const { return sample_->flags(); }
+    int32_t streamNumber() const { return sample_->streamNumber(); }
+
+    primo::codecs::PictureType::Enum pictureType() const { return sample_->pictureType(); }
+    primo::codecs::FrameType::Enum   frameType()   const { return sample_->frameType(); }
+
+    primo::codecs::MediaSample* get() const { return sample_; }
 };
 
 class TMediaSample {
@@ -277,6 +750,17 @@ public:
         return TMediaBuffer(sample_->buffer());
     }
 
+    /// Returns a non-owning view of the buffer. Prefer this over @c buffer() in
+    /// pull loops that only read the data: it does not retain the buffer.
+    TMediaBufferView bufferView() const {
+        return TMediaBufferView(sample_->buffer());
+    }
+
+    /// Returns a non-owning, read-only view of this sample.
+    TMediaSampleView view() const {
+        return TMediaSampleView(sample_.get());
+    }
+
     double  startTime()    const { return sample_->startTime(); }
     double  endTime()      const { return sample_->endTime(); }
     int32_t flags()        const { return sample_->flags(); }
@@ -326,6 +810,323 @@ public:
     primo::codecs::MediaSample* get() const { return sample_.get(); }
 };
 
+/**
+ * Recycling pool of @c MediaBuffer objects for push/pull loops.
+ *
+ * Buffers are grouped into power-of-two size classes (4 KiB minimum). The pool
+ * keeps its own reference to every buffer it creates; a buffer becomes
+ * available again as soon as that is the only reference left, i.e. once the
+ * returned @c TMediaBuffer, every @c TMediaSample it was set on and the SDK
+ * have all released it. There is no explicit give-back call.
+ *
+ * The optional high-water mark caps the total capacity owned by the pool.
+ * When a new buffer would exceed it, idle buffers of other size classes are
+ * evicted first; if that is not enough, @c acquire() falls back to a plain
+ * unpooled @c TMediaBuffer. Thread-safe.
+ */
+class TMediaBufferPool {
+    static constexpr int32_t kMinClassShift = 12;   // 4 KiB
+    static constexpr int32_t kMaxClassShift = 30;   // 1 GiB
+    static constexpr int32_t kClassCount    = kMaxClassShift - kMinClassShift + 1;
+
+    mutable std::mutex mutex_;
+    std::vector<primo::ref<primo::codecs::MediaBuffer>> classes_[kClassCount];
+    size_t  highWaterMark_{};
+    size_t  pooledBytes_{};
+    int64_t hits_{};
+    int64_t misses_{};
+
+    static int32_t classIndex(int32_t size) {
+        int32_t shift = kMinClassShift;
+        while (shift < kMaxClassShift && (int32_t(1) << shift) < size)
+            ++shift;
+        return shift - kMinClassShift;
+    }
+
+    static int32_t classSize(int32_t index) {
+        return int32_t(1) << (index + kMinClassShift);
+    }
+
+    static bool idle(const primo::ref<primo::codecs::MediaBuffer>& buffer) {
+        const int32_t count = buffer->retainCount();
+        if (count == 1)
+            return true;
+
+        // A zero-copy attach() on a pooled buffer adds a reference from the external storage registry.
+        return count == 2 && buffer->external() == TRUE &&
+               detail::TExternalStorage::instance().releaseShared(buffer.get());
+    }
+
+    // Drops idle buffers (other than class @p keep) until @p needed bytes fit under the mark.
+    void evictFor(size_t needed, int32_t keep) {
+        for (int32_t i = kClassCount - 1; i >= 0 && pooledBytes_ + needed > highWaterMark_; --i) {
+            if (i == keep)
+                continue;
+
+            auto& slots = classes_[i];
+            for (size_t j = 0; j < slots.size() && pooledBytes_ + needed > highWaterMark_; ) {
+                if (idle(slots[j])) {
+                    pooledBytes_ -= static_cast<size_t>(classSize(i));
+                    slots[j] = std::move(slots.back());
+                    slots.pop_back();
+                } else {
+                    ++j;
+                }
+            }
+        }
+    }
+
+public:
+    /// Creates a pool. @p highWaterMark is the maximum number of bytes the pool may own; 0 means unlimited.
+    explicit TMediaBufferPool(size_t highWaterMark = 0)
+        : highWaterMark_(highWaterMark) {}
+
+    TMediaBufferPool(const TMediaBufferPool&) = delete;
+    TMediaBufferPool& operator=(const TMediaBufferPool&) = delete;
+
+    /// Sets the maximum number of bytes the pool may own; 0 means unlimited.
+    /// Lowering the mark evicts idle buffers immediately.
+    TMediaBufferPool& highWaterMark(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        highWaterMark_ = bytes;
+        if (highWaterMark_ != 0)
+            evictFor(0, -1);
+        return *this;
+    }
+
+    size_t highWaterMark() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return highWaterMark_;
+    }
+
+    /// Returns a buffer with @c capacity() >= @p size and no data (@c dataSize() == 0).
+    /// Fill it through @c start() and publish the bytes with @c setData().
+    TMediaBuffer acquire(int32_t size) {
+        if (size > classSize(kClassCount - 1))
+            return TMediaBuffer(size);
+
+        const int32_t index = classIndex(size);
+        const int32_t bytes = classSize(index);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto& slot : classes_[index]) {
+            if (!idle(slot))
+                continue;
+
+            // The previous user may have re-allocated or attached external memory.
+            if (slot->external() == TRUE || slot->capacity() < bytes)
+                slot->alloc(bytes, FALSE);
+
+            slot->setData(0, 0);
+            ++hits_;
+            return TMediaBuffer(slot.get());
+        }
+
+        ++misses_;
+
+        if (highWaterMark_ != 0 && pooledBytes_ + bytes > highWaterMark_) {
+            evictFor(static_cast<size_t>(bytes), index);
+            if (pooledBytes_ + bytes > highWaterMark_)
+                return TMediaBuffer(size);
+        }
+
+        primo::ref<primo::codecs::MediaBuffer> slot(
+            primo::avblocks::Library::createMediaBuffer(bytes));
+        slot->setData(0, 0);
+        pooledBytes_ += static_cast<size_t>(bytes);
+
+        TMediaBuffer buffer(slot.get());
+        classes_[index].push_back(std::move(slot));
+        return buffer;
+    }
+
+    /// Releases every idle buffer. Buffers still in use stay tracked.
+    TMediaBufferPool& trim() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int32_t i = 0; i < kClassCount; ++i) {
+            auto& slots = classes_[i];
+            for (size_t j = 0; j < slots.size(); ) {
+                if (idle(slots[j])) {
+                    pooledBytes_ -= static_cast<size_t>(classSize(i));
+                    slots[j] = std::move(slots.back());
+                    slots.pop_back();
+                } else {
+                    ++j;
+                }
+            }
+        }
+        return *this;
+    }
+
+    /// Total capacity, in bytes, of the buffers owned by the pool (idle or in use).
+    size_t pooledBytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pooledBytes_;
+    }
+
+    /// Number of @c acquire() calls served by recycling an idle buffer.
+    int64_t hits() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return hits_;
+    }
+
+    /// Number of @c acquire() calls that had to allocate.
+    int64_t misses() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return misses_;
+    }
+};
+
+namespace detail {
+
+/// Copies timing, flags and picture info of @p from onto @p to; the buffer is left alone.
+inline void copySampleTiming(const TMediaSample& from, TMediaSample& to) {
+    to.startTime(from.startTime())
+      .endTime(from.endTime())
+      .flags(from.flags())
+      .streamNumber(from.streamNumber())
+      .pictureType(from.pictureType())
+      .frameType(from.frameType());
+}
+
+/// Copies @p from into @p to, payload included, using a buffer from @p pool.
+/// Needed wherever a pulled sample outlives the next @c pull(): the SDK may
+/// reuse the buffer it returned.
+inline void copySample(TMediaBufferPool& pool, const TMediaSample& from, TMediaSample& to) {
+    TMediaBufferView src = from.bufferView();
+    if (src.valid() && src.dataSize() > 0) {
+        TMediaBuffer copy = pool.acquire(src.dataSize());
+        std::memcpy(copy.start(), src.data(), static_cast<size_t>(src.dataSize()));
+        copy.setData(0, src.dataSize());
+        to.buffer(std::move(copy));
+    } else {
+        to.buffer(nullptr);
+    }
+    copySampleTiming(from, to);
+}
+
+} // namespace detail
+
+/**
+ * Streaming byte buffer for incremental parsers, built on a @c MediaBuffer.
+ *
+ * Producers @c reserve() space at the tail, write into it and @c commit() the
+ * bytes actually written; parsers look at @c readable() and @c consume() what
+ * they have handled. Data is never copied on the way in or out. When the tail
+ * runs out of room the live bytes are either compacted to the front or the
+ * storage grows: compaction (a memmove of the live bytes) is only chosen when
+ * those bytes are no more than the space it reclaims at the head, so every
+ * byte is moved a bounded number of times; otherwise the capacity doubles.
+ *
+ * @c readable() and the spans returned by @c reserve() are invalidated by the
+ * next @c reserve() / @c append().
+ *
+ * Sizes are @c int32_t like the SDK buffer underneath. @c reserve() throws
+ * @c std::invalid_argument for a negative size and @c std::length_error when
+ * the ring would exceed @c INT32_MAX bytes; @c commit() throws
+ * @c std::out_of_range for more bytes than the last reservation provided.
+ */
+class TByteRing {
+    TMediaBuffer buffer_;
+    int64_t      bytesMoved_{};
+
+public:
+    /// Creates a ring with an initial capacity of @p capacity bytes.
+    explicit TByteRing(int32_t capacity = 64 * 1024)
+        : buffer_(capacity > 0 ? capacity : 1) {
+        buffer_.setData(0, 0);
+    }
+
+    TByteRing(const TByteRing&) = delete;
+    TByteRing& operator=(const TByteRing&) = delete;
+    TByteRing(TByteRing&&) = default;
+    TByteRing& operator=(TByteRing&&) = default;
+
+    /// Returns at least @p size writable bytes at the tail. Write into them, then call @c commit().
+    std::span<uint8_t> reserve(int32_t size) {
+        if (size < 0)
+            throw std::invalid_argument("TByteRing::reserve: negative size");
+
+        if (buffer_.freeLinearSpace() < size) {
+            const int32_t live = buffer_.dataSize();
+            const int32_t head = buffer_.dataOffset();
+
+            if (live <= head && buffer_.freeSpace() >= size) {
+                buffer_.normalize();
+                bytesMoved_ += live;
+            } else {
+                constexpr size_t maxCapacity = static_cast<size_t>(std::numeric_limits<int32_t>::max());
+                const size_t needed = static_cast<size_t>(live) + static_cast<size_t>(size);
+                if (needed > maxCapacity)
+                    throw std::length_error("TByteRing::reserve: ring would exceed INT32_MAX bytes");
+
+                size_t capacity = static_cast<size_t>(buffer_.capacity());
+                while (capacity < needed)
+                    capacity *= 2;
+
+                TMediaBuffer grown(static_cast<int32_t>(std::min(capacity, maxCapacity)));
+                if (live > 0)
+                    std::memcpy(grown.start(), buffer_.data(), static_cast<size_t>(live));
+                grown.setData(0, live);
+
+                buffer_ = std::move(grown);
+                bytesMoved_ += live;
+            }
+        }
+
+        return { buffer_.start() + buffer_.dataOffset() + buffer_.dataSize(),
+                 static_cast<size_t>(buffer_.freeLinearSpace()) };
+    }
+
+    /// Publishes @p size bytes written into the span returned by the last @c reserve().
+    TByteRing& commit(int32_t size) {
+        if (size < 0 || size > buffer_.freeLinearSpace())
+            throw std::out_of_range("TByteRing::commit: size exceeds the reserved space");
+        buffer_.setData(buffer_.dataOffset(), buffer_.dataSize() + size);
+        return *this;
+    }
+
+    /// Copies @p size bytes from @p data to the tail (reserve + copy + commit).
+    TByteRing& append(const void* data, int32_t size) {
+        auto span = reserve(size);
+        std::memcpy(span.data(), data, static_cast<size_t>(size));
+        return commit(size);
+    }
+
+    /// Returns the bytes committed but not yet consumed, contiguous.
+    std::span<const uint8_t> readable() const {
+        return { buffer_.data(), static_cast<size_t>(buffer_.dataSize()) };
+    }
+
+    /// Drops @p size bytes from the head. Consuming everything rewinds to the start of the storage.
+    TByteRing& consume(int32_t size) {
+        if (size <= 0)
+            return *this;
+        if (size >= buffer_.dataSize())
+            buffer_.setData(0, 0);
+        else
+            buffer_.setData(buffer_.dataOffset() + size, buffer_.dataSize() - size);
+        return *this;
+    }
+
+    TByteRing& clear() {
+        buffer_.setData(0, 0);
+        return *this;
+    }
+
+    int32_t size()     const { return buffer_.dataSize(); }
+    bool    empty()    const { return buffer_.dataSize() == 0; }
+    int32_t capacity() const { return buffer_.capacity(); }
+
+    /// Total bytes moved by compaction or growth; a cheap way to check the ring is sized right.
+    int64_t bytesMoved() const { return bytesMoved_; }
+
+    /// The underlying buffer; its data range is exactly the readable bytes.
+    TMediaBuffer&       buffer()       { return buffer_; }
+    const TMediaBuffer& buffer() const { return buffer_; }
+};
+
 // ---- Metadata wrappers -------------------------------------------------------
 
 /**
@@ -973,32 +1774,484 @@ public:
     }
 };
 
-class TMediaPin {
-    primo::ref<primo::avblocks::MediaPin> pin_;
-    
+/**
+ * Base for the non-owning, read-only stream info views.
+ *
+ * The views do not retain the underlying object; they are valid while the
+ * owning pin, socket or transcoder is alive. Use them when only reading
+ * properties, e.g. inside a pull loop, to avoid the retain/release pair of
+ * the owning @c TAudioStreamInfo / @c TVideoStreamInfo wrappers.
+ */
+template<typename RawT>
+class TStreamInfoView {
+protected:
+    RawT* info_{};
+
 public:
-    TMediaPin() 
-        : pin_(primo::avblocks::Library::createMediaPin()) {}
-    
-    explicit TMediaPin(primo::ref<primo::avblocks::MediaPin> pin)
-        : pin_(std::move(pin)) {}
+    TStreamInfoView() = default;
+    explicit TStreamInfoView(RawT* info) : info_(info) {}
 
-    /// Wraps a non-owned @c MediaPin pointer, retaining it. Used by @c TMediaSocketT::pin().
-    explicit TMediaPin(primo::avblocks::MediaPin* pin)
-        : pin_(pin) { if (pin) pin->retain(); }
-    
-    // Delete copy operations
-    TMediaPin(const TMediaPin&) = delete;
-    TMediaPin& operator=(const TMediaPin&) = delete;
-    
-    // Enable move operations
-    TMediaPin(TMediaPin&&) = default;
-    TMediaPin& operator=(TMediaPin&&) = default;
-    
-    TMediaPin&& streamInfo(const TAudioStreamInfo& info) && {
-        pin_->setStreamInfo(info.get());
-        return std::move(*this);
-    }
+    bool valid() const { return info_ != nullptr; }
+
+    primo::codecs::MediaType::Enum     mediaType()     const { return info_->mediaType(); }
+    primo::codecs::StreamType::Enum    streamType()    const { return info_->streamType(); }
+    primo::codecs::StreamSubType::Enum streamSubType() const { return info_->streamSubType(); }
+    double                             duration()      const { return info_->duration(); }
+    int32_t                            bitrate()       const { return info_->bitrate(); }
+    int32_t                            bitrateMode()   const { return info_->bitrateMode(); }
+    int32_t                            ID()            const { return info_->ID(); }
+    int32_t                            programNumber() const { return info_->programNumber(); }
+
+    RawT* get() const { return info_; }
+};
+
+/// Non-owning, read-only view of an @c AudioStreamInfo. Returned by @c TMediaPin::audioStreamInfoView().
+class TAudioStreamInfoView : public TStreamInfoView<primo::codecs::AudioStreamInfo> {
+public:
+    using TStreamInfoView::TStreamInfoView;
+
+    /// Views the stream info held by an owning wrapper.
+    TAudioStreamInfoView(const TAudioStreamInfo& info) : TStreamInfoView(info.get()) {}
+
+    int32_t channels()      const { return info_->channels(); }
+    int32_t sampleRate()    const { return info_->sampleRate(); }
+    int32_t bitsPerSample() const { return info_->bitsPerSample(); }
+    int32_t pcmFlags()      const { return info_->pcmFlags(); }
+    int32_t channelLayout() const { return info_->channelLayout(); }
+    int32_t bytesPerFrame() const { return info_->bytesPerFrame(); }
+};
+
+/// Non-owning, read-only view of a @c VideoStreamInfo. Returned by @c TMediaPin::videoStreamInfoView().
+class TVideoStreamInfoView : public TStreamInfoView<primo::codecs::VideoStreamInfo> {
+public:
+    using TStreamInfoView::TStreamInfoView;
+
+    /// Views the stream info held by an owning wrapper.
+    TVideoStreamInfoView(const TVideoStreamInfo& info) : TStreamInfoView(info.get()) {}
+
+    primo::codecs::ColorFormat::Enum colorFormat()        const { return info_->colorFormat(); }
+    int32_t                          frameWidth()         const { return info_->frameWidth(); }
+    int32_t                          frameHeight()        const { return info_->frameHeight(); }
+    int32_t                          displayRatioWidth()  const { return info_->displayRatioWidth(); }
+    int32_t                          displayRatioHeight() const { return info_->displayRatioHeight(); }
+    double                           frameRate()          const { return info_->frameRate(); }
+    primo::codecs::ScanType::Enum    scanType()           const { return info_->scanType(); }
+    int32_t                          stride()             const { return info_->stride(); }
+    bool                             frameBottomUp()      const { return info_->frameBottomUp() == TRUE; }
+};
+
+// ---- Raw video frame views ---------------------------------------------------
+
+/// Memory layout of one plane of an uncompressed video format.
+struct TPlaneLayout {
+    int32_t groupWidth;   ///< Luma pixels covered by one sample group in a row.
+    int32_t groupBytes;   ///< Bytes taken by one sample group.
+    int32_t rowDivisor;   ///< Vertical subsampling: frame rows per plane row.
+};
+
+/**
+ * Memory layout of an uncompressed @c ColorFormat: its planes in memory order.
+ *
+ * Planes are stored back to back. The stride of plane 0 is the stride reported
+ * by @c TVideoStreamInfo::stride() (0 means tightly packed); the strides of
+ * the other planes scale with their bytes per pixel, e.g. half the luma
+ * stride for the chroma planes of YV12.
+ */
+struct TColorFormatLayout {
+    int32_t      planeCount{};
+    TPlaneLayout planes[4]{};
+
+    constexpr int32_t rowBytes(int32_t plane, int32_t width) const {
+        const TPlaneLayout& p = planes[plane];
+        return (width + p.groupWidth - 1) / p.groupWidth * p.groupBytes;
+    }
+
+    constexpr int32_t rows(int32_t plane, int32_t height) const {
+        return (height + planes[plane].rowDivisor - 1) / planes[plane].rowDivisor;
+    }
+
+    /// Returns the stride of @p plane, given the stride of plane 0 (0 = tightly packed).
+    constexpr int32_t stride(int32_t plane, int32_t width, int32_t stride0) const {
+        const int32_t tight = rowBytes(plane, width);
+        if (stride0 <= 0)
+            return tight;
+        if (plane == 0)
+            return stride0;
+
+        const TPlaneLayout& p  = planes[plane];
+        const TPlaneLayout& p0 = planes[0];
+        const int64_t num = int64_t(stride0) * p.groupBytes * p0.groupWidth;
+        const int64_t den = int64_t(p.groupWidth) * p0.groupBytes;
+        const int32_t scaled = static_cast<int32_t>((num + den - 1) / den);
+        return scaled < tight ? tight : scaled;
+    }
+
+    /// Returns the number of bytes a whole frame occupies.
+    constexpr int64_t frameBytes(int32_t width, int32_t height, int32_t stride0) const {
+        int64_t total = 0;
+        for (int32_t i = 0; i < planeCount; ++i)
+            total += int64_t(stride(i, width, stride0)) * rows(i, height);
+        return total;
+    }
+
+    /// Returns the horizontal / vertical alignment a crop origin must respect.
+    constexpr int32_t cropAlignX() const {
+        int32_t a = 1;
+        for (int32_t i = 0; i < planeCount; ++i)
+            if (planes[i].groupWidth > a) a = planes[i].groupWidth;
+        return a;
+    }
+
+    constexpr int32_t cropAlignY() const {
+        int32_t a = 1;
+        for (int32_t i = 0; i < planeCount; ++i)
+            if (planes[i].rowDivisor > a) a = planes[i].rowDivisor;
+        return a;
+    }
+};
+
+/// Returns the memory layout of @p format, or a layout with @c planeCount == 0
+/// for formats that are not uncompressed (or unknown).
+constexpr TColorFormatLayout colorFormatLayout(primo::codecs::ColorFormat::Enum format) {
+    using CF = primo::codecs::ColorFormat;
+
+    constexpr TPlaneLayout full    { 1, 1, 1 };   // one byte per pixel
+    constexpr TPlaneLayout half420 { 2, 1, 2 };   // 4:2:0 chroma
+    constexpr TPlaneLayout half422 { 2, 1, 1 };   // 4:2:2 chroma
+    constexpr TPlaneLayout quarter { 4, 1, 1 };   // 4:1:1 chroma
+
+    switch (format) {
+    case CF::YV12:    return { 3, { full, half420, half420 } };           // Y, V, U
+    case CF::YUV420:  return { 3, { full, half420, half420 } };           // Y, U, V
+    case CF::NV12:    return { 2, { full, { 2, 2, 2 } } };                // Y, interleaved UV
+    case CF::YUV422:  return { 3, { full, half422, half422 } };           // Y, U, V
+    case CF::YUV411:  return { 3, { full, quarter, quarter } };           // Y, U, V
+    case CF::YUV444:  return { 3, { full, full, full } };                 // Y, U, V
+    case CF::YVU9:    return { 3, { full, { 4, 1, 4 }, { 4, 1, 4 } } };   // Y, V, U
+    case CF::YUV420A: return { 4, { full, half420, half420, full } };     // Y, U, V, A
+    case CF::YUV422A: return { 4, { full, half422, half422, full } };     // Y, U, V, A
+    case CF::YUV444A: return { 4, { full, full, full, full } };           // Y, U, V, A
+    case CF::YUY2:    return { 1, { { 2, 4, 1 } } };                      // Y0 U Y1 V
+    case CF::UYVY:    return { 1, { { 2, 4, 1 } } };                      // U Y0 V Y1
+    case CF::Y411:    return { 1, { { 4, 6, 1 } } };                      // U Y0 Y1 V Y2 Y3
+    case CF::Y41P:    return { 1, { { 8, 12, 1 } } };                     // 8 pixels in 12 bytes
+    case CF::BGR32:   return { 1, { { 1, 4, 1 } } };
+    case CF::BGRA32:  return { 1, { { 1, 4, 1 } } };
+    case CF::BGR24:   return { 1, { { 1, 3, 1 } } };
+    case CF::BGR565:  return { 1, { { 1, 2, 1 } } };
+    case CF::BGR555:  return { 1, { { 1, 2, 1 } } };
+    case CF::BGR444:  return { 1, { { 1, 2, 1 } } };
+    case CF::GRAY:    return { 1, { full } };
+    default:          return {};
+    }
+}
+
+/**
+ * Non-owning view of one plane of a video frame.
+ *
+ * @p T is @c uint8_t for writable planes and @c const @c uint8_t for read-only
+ * ones. Row 0 is always the top row of the picture; bottom-up frames are
+ * represented with a negative @c stride().
+ */
+template<typename T>
+class TPlaneView {
+    T*        origin_{};
+    ptrdiff_t stride_{};
+    int32_t   rowBytes_{};
+    int32_t   rows_{};
+
+public:
+    constexpr TPlaneView() = default;
+
+    constexpr TPlaneView(T* origin, ptrdiff_t stride, int32_t rowBytes, int32_t rows)
+        : origin_(origin), stride_(stride), rowBytes_(rowBytes), rows_(rows) {}
+
+    /// Read-only view of a writable plane.
+    constexpr operator TPlaneView<const T>() const requires (!std::is_const_v<T>) {
+        return TPlaneView<const T>(origin_, stride_, rowBytes_, rows_);
+    }
+
+    /// Returns the first byte of the top row.
+    constexpr T*        data()     const { return origin_; }
+    /// Returns the distance in bytes from one row to the next one down; negative for bottom-up planes.
+    constexpr ptrdiff_t stride()   const { return stride_; }
+    /// Returns the number of meaningful bytes in a row (excludes padding).
+    constexpr int32_t   rowBytes() const { return rowBytes_; }
+    constexpr int32_t   rows()     const { return rows_; }
+
+    /// Returns row @p y (0 = top) without its padding.
+    constexpr std::span<T> row(int32_t y) const {
+        return { origin_ + y * stride_, static_cast<size_t>(rowBytes_) };
+    }
+
+    /// Returns @c true if the rows follow each other top to bottom without padding.
+    constexpr bool contiguous() const { return stride_ == rowBytes_; }
+
+    /// Returns the sub-plane starting @p byteOffset bytes into row @p rowOffset.
+    constexpr TPlaneView sub(int32_t byteOffset, int32_t rowOffset, int32_t rowBytes, int32_t rows) const {
+        return TPlaneView(origin_ + rowOffset * stride_ + byteOffset, stride_, rowBytes, rows);
+    }
+};
+
+namespace detail {
+
+template<typename T>
+int32_t mapPlanes(const TColorFormatLayout& layout, T* data, size_t size,
+                  int32_t width, int32_t height, int32_t stride, bool bottomUp,
+                  TPlaneView<T>* planes) {
+    if (layout.planeCount == 0)
+        throw std::invalid_argument("Unsupported color format for a video frame view");
+    if (width <= 0 || height <= 0)
+        throw std::invalid_argument("Invalid video frame dimensions");
+    if (stride > 0 && stride < layout.rowBytes(0, width))
+        throw std::invalid_argument("Video frame stride is smaller than a row");
+    if (static_cast<uint64_t>(layout.frameBytes(width, height, stride)) > size)
+        throw std::length_error("Video frame does not fit in the buffer");
+
+    T* plane = data;
+    for (int32_t i = 0; i < layout.planeCount; ++i) {
+        const int32_t   rows      = layout.rows(i, height);
+        const ptrdiff_t rowStride = layout.stride(i, width, stride);
+        T* top = bottomUp ? plane + (rows - 1) * rowStride : plane;
+        planes[i] = TPlaneView<T>(top, bottomUp ? -rowStride : rowStride, layout.rowBytes(i, width), rows);
+        plane += rows * rowStride;
+    }
+    return layout.planeCount;
+}
+
+template<typename T>
+void cropPlanes(const TColorFormatLayout& layout, const TPlaneView<T>* in, TPlaneView<T>* out,
+                int32_t frameWidth, int32_t frameHeight,
+                int32_t x, int32_t y, int32_t width, int32_t height) {
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        x + width > frameWidth || y + height > frameHeight)
+        throw std::out_of_range("Crop rectangle is outside the video frame");
+    if (x % layout.cropAlignX() != 0 || y % layout.cropAlignY() != 0)
+        throw std::invalid_argument("Crop origin is not aligned to the color format's subsampling");
+
+    for (int32_t i = 0; i < layout.planeCount; ++i) {
+        const TPlaneLayout& p = layout.planes[i];
+        out[i] = in[i].sub(x / p.groupWidth * p.groupBytes, y / p.rowDivisor,
+                           layout.rowBytes(i, width), layout.rows(i, height));
+    }
+}
+
+} // namespace detail
+
+/**
+ * Compile-time specialized view of an uncompressed video frame in @p Format.
+ *
+ * Exposes one @c TPlaneView per plane in memory order (see
+ * @c colorFormatLayout()); plane count and subsampling are constants, so
+ * per-pixel loops written against this view compile to straight pointer
+ * arithmetic. @c crop() returns a zero-copy sub-view.
+ *
+ * Constructors throw @c std::invalid_argument for a mismatching or unsupported
+ * format and @c std::length_error when the buffer is too small for the frame.
+ */
+template<primo::codecs::ColorFormat::Enum Format, typename T = const uint8_t>
+class TVideoFrameView {
+public:
+    static constexpr TColorFormatLayout layout     = colorFormatLayout(Format);
+    static constexpr int32_t            planeCount = layout.planeCount;
+    static_assert(planeCount > 0, "ColorFormat has no uncompressed memory layout");
+
+    using Planes = std::array<TPlaneView<T>, planeCount>;
+
+private:
+    Planes  planes_{};
+    int32_t width_{};
+    int32_t height_{};
+
+public:
+    TVideoFrameView() = default;
+
+    /// Views @p size bytes at @p data as a @p width x @p height frame.
+    /// @p stride is the stride of plane 0 in bytes (0 = tightly packed).
+    TVideoFrameView(T* data, size_t size, int32_t width, int32_t height,
+                    int32_t stride = 0, bool bottomUp = false)
+        : width_(width), height_(height) {
+        detail::mapPlanes(layout, data, size, width, height, stride, bottomUp, planes_.data());
+    }
+
+    /// Views the data of @p buffer using the geometry in @p info.
+    TVideoFrameView(TMediaBufferView buffer, TVideoStreamInfoView info) requires std::is_const_v<T>
+        : TVideoFrameView(checked(info), buffer.data(), static_cast<size_t>(buffer.dataSize()), info) {}
+
+    /// Views the data of @p buffer using the geometry in @p info (writable when @p T is non-const).
+    TVideoFrameView(TMediaBuffer& buffer, TVideoStreamInfoView info)
+        : TVideoFrameView(checked(info), buffer.start() + buffer.dataOffset(),
+                          static_cast<size_t>(buffer.dataSize()), info) {}
+
+    /// Assembles a view from already mapped planes (used by @c TAnyVideoFrameView::visit()).
+    TVideoFrameView(int32_t width, int32_t height, const Planes& planes)
+        : planes_(planes), width_(width), height_(height) {}
+
+    static constexpr primo::codecs::ColorFormat::Enum colorFormat() { return Format; }
+
+    int32_t width()  const { return width_; }
+    int32_t height() const { return height_; }
+
+    template<int32_t I>
+    const TPlaneView<T>& plane() const {
+        static_assert(I >= 0 && I < planeCount, "Plane index out of range");
+        return planes_[I];
+    }
+
+    const TPlaneView<T>& plane(int32_t index) const { return planes_[index]; }
+    const Planes&        planes()             const { return planes_; }
+
+    /// Returns a zero-copy view of the @p width x @p height rectangle at (@p x, @p y).
+    /// The origin must be aligned to the format's chroma subsampling.
+    TVideoFrameView crop(int32_t x, int32_t y, int32_t width, int32_t height) const {
+        Planes out{};
+        detail::cropPlanes(layout, planes_.data(), out.data(), width_, height_, x, y, width, height);
+        return TVideoFrameView(width, height, out);
+    }
+
+private:
+    struct Checked {};
+
+    static Checked checked(const TVideoStreamInfoView& info) {
+        if (info.colorFormat() != Format)
+            throw std::invalid_argument("Stream color format does not match the frame view");
+        return {};
+    }
+
+    TVideoFrameView(Checked, T* data, size_t size, const TVideoStreamInfoView& info)
+        : TVideoFrameView(data, size, info.frameWidth(), info.frameHeight(),
+                          info.stride(), info.frameBottomUp()) {}
+};
+
+/**
+ * Runtime-dispatched counterpart of @c TVideoFrameView, for frames whose
+ * @c ColorFormat is only known from the stream info.
+ *
+ * Provides the same plane access and cropping; @c visit() calls a generic
+ * visitor with the matching compile-time @c TVideoFrameView so hot loops can
+ * still be specialized per format.
+ */
+template<typename T = const uint8_t>
+class TAnyVideoFrameView {
+    primo::codecs::ColorFormat::Enum format_{primo::codecs::ColorFormat::Unknown};
+    TColorFormatLayout               layout_{};
+    TPlaneView<T>                    planes_[4]{};
+    int32_t                          width_{};
+    int32_t                          height_{};
+
+public:
+    TAnyVideoFrameView() = default;
+
+    /// Views @p size bytes at @p data as a @p width x @p height frame in @p format.
+    TAnyVideoFrameView(T* data, size_t size, primo::codecs::ColorFormat::Enum format,
+                       int32_t width, int32_t height, int32_t stride = 0, bool bottomUp = false)
+        : format_(format), layout_(colorFormatLayout(format)), width_(width), height_(height) {
+        detail::mapPlanes(layout_, data, size, width, height, stride, bottomUp, planes_);
+    }
+
+    /// Views the data of @p buffer using the format and geometry in @p info.
+    TAnyVideoFrameView(TMediaBufferView buffer, TVideoStreamInfoView info) requires std::is_const_v<T>
+        : TAnyVideoFrameView(buffer.data(), static_cast<size_t>(buffer.dataSize()), info.colorFormat(),
+                             info.frameWidth(), info.frameHeight(), info.stride(), info.frameBottomUp()) {}
+
+    /// Views the data of @p buffer using the format and geometry in @p info.
+    TAnyVideoFrameView(TMediaBuffer& buffer, TVideoStreamInfoView info)
+        : TAnyVideoFrameView(buffer.start() + buffer.dataOffset(), static_cast<size_t>(buffer.dataSize()),
+                             info.colorFormat(), info.frameWidth(), info.frameHeight(),
+                             info.stride(), info.frameBottomUp()) {}
+
+    primo::codecs::ColorFormat::Enum colorFormat() const { return format_; }
+    const TColorFormatLayout&        layout()      const { return layout_; }
+
+    int32_t width()      const { return width_; }
+    int32_t height()     const { return height_; }
+    int32_t planeCount() const { return layout_.planeCount; }
+
+    const TPlaneView<T>& plane(int32_t index) const { return planes_[index]; }
+
+    /// Returns a zero-copy view of the @p width x @p height rectangle at (@p x, @p y).
+    TAnyVideoFrameView crop(int32_t x, int32_t y, int32_t width, int32_t height) const {
+        TAnyVideoFrameView out;
+        out.format_ = format_;
+        out.layout_ = layout_;
+        out.width_  = width;
+        out.height_ = height;
+        detail::cropPlanes(layout_, planes_, out.planes_, width_, height_, x, y, width, height);
+        return out;
+    }
+
+    /// Returns this frame as the compile-time view for @p Format.
+    /// Throws @c std::invalid_argument if the frame is in a different format.
+    template<primo::codecs::ColorFormat::Enum Format>
+    TVideoFrameView<Format, T> as() const {
+        if (format_ != Format)
+            throw std::invalid_argument("Video frame is not in the requested color format");
+
+        typename TVideoFrameView<Format, T>::Planes planes{};
+        for (size_t i = 0; i < planes.size(); ++i)
+            planes[i] = planes_[i];
+        return TVideoFrameView<Format, T>(width_, height_, planes);
+    }
+
+    /// Calls @p visitor with the @c TVideoFrameView matching the runtime format.
+    template<typename Visitor>
+    auto visit(Visitor&& visitor) const
+        -> std::invoke_result_t<Visitor, TVideoFrameView<primo::codecs::ColorFormat::GRAY, T>> {
+        using CF = primo::codecs::ColorFormat;
+        switch (format_) {
+        case CF::YV12:    return visitor(as<CF::YV12>());
+        case CF::YUV420:  return visitor(as<CF::YUV420>());
+        case CF::NV12:    return visitor(as<CF::NV12>());
+        case CF::YUV422:  return visitor(as<CF::YUV422>());
+        case CF::YUV411:  return visitor(as<CF::YUV411>());
+        case CF::YUV444:  return visitor(as<CF::YUV444>());
+        case CF::YVU9:    return visitor(as<CF::YVU9>());
+        case CF::YUV420A: return visitor(as<CF::YUV420A>());
+        case CF::YUV422A: return visitor(as<CF::YUV422A>());
+        case CF::YUV444A: return visitor(as<CF::YUV444A>());
+        case CF::YUY2:    return visitor(as<CF::YUY2>());
+        case CF::UYVY:    return visitor(as<CF::UYVY>());
+        case CF::Y411:    return visitor(as<CF::Y411>());
+        case CF::Y41P:    return visitor(as<CF::Y41P>());
+        case CF::BGR32:   return visitor(as<CF::BGR32>());
+        case CF::BGRA32:  return visitor(as<CF::BGRA32>());
+        case CF::BGR24:   return visitor(as<CF::BGR24>());
+        case CF::BGR565:  return visitor(as<CF::BGR565>());
+        case CF::BGR555:  return visitor(as<CF::BGR555>());
+        case CF::BGR444:  return visitor(as<CF::BGR444>());
+        case CF::GRAY:    return visitor(as<CF::GRAY>());
+        default:
+            throw std::invalid_argument("Unsupported color format for a video frame view");
+        }
+    }
+};
+
+class TMediaPin {
+    primo::ref<primo::avblocks::MediaPin> pin_;
+    
+public:
+    TMediaPin() 
+        : pin_(primo::avblocks::Library::createMediaPin()) {}
+    
+    explicit TMediaPin(primo::ref<primo::avblocks::MediaPin> pin)
+        : pin_(std::move(pin)) {}
+
+    /// Wraps a non-owned @c MediaPin pointer, retaining it. Used by @c TMediaSocketT::pin().
+    explicit TMediaPin(primo::avblocks::MediaPin* pin)
+        : pin_(pin) { if (pin) pin->retain(); }
+    
+    // Delete copy operations
+    TMediaPin(const TMediaPin&) = delete;
+    TMediaPin& operator=(const TMediaPin&) = delete;
+    
+    // Enable move operations
+    TMediaPin(TMediaPin&&) = default;
+    TMediaPin& operator=(TMediaPin&&) = default;
+    
+    TMediaPin&& streamInfo(const TAudioStreamInfo& info) && {
+        pin_->setStreamInfo(info.get());
+        return std::move(*this);
+    }
     
     TMediaPin& streamInfo(const TAudioStreamInfo& info) & {
         pin_->setStreamInfo(info.get());
@@ -1027,6 +2280,18 @@ public:
             static_cast<primo::codecs::VideoStreamInfo*>(pin_->streamInfo()));
     }
 
+    /// Returns a non-owning view of the pin's stream info as audio. Does not retain it.
+    TAudioStreamInfoView audioStreamInfoView() const {
+        return TAudioStreamInfoView(
+            static_cast<primo::codecs::AudioStreamInfo*>(pin_->streamInfo()));
+    }
+
+    /// Returns a non-owning view of the pin's stream info as video. Does not retain it.
+    TVideoStreamInfoView videoStreamInfoView() const {
+        return TVideoStreamInfoView(
+            static_cast<primo::codecs::VideoStreamInfo*>(pin_->streamInfo()));
+    }
+
     /// Returns the pin's stream info as a @c TDataStreamInfo (base @c StreamInfo view),
     /// wrapping the existing pointer. Use to access @c mediaType(), @c streamType(),
     /// @c ID(), @c programNumber() without knowing the concrete media type.
@@ -1433,6 +2698,135 @@ public:
 using TMediaInfo  = TMediaInfoT<char>;
 using TMediaInfoW = TMediaInfoT<wchar_t>;
 
+// ---- Coroutine support -------------------------------------------------------
+
+/// One item produced by @c TTranscoderT::samples(): the output index and a view of the pulled sample.
+struct TPulledSample {
+    int32_t          outputIndex = 0;
+    TMediaSampleView sample;
+};
+
+namespace detail {
+
+/**
+ * Minimal synchronous generator used by @c TGenerator when @c std::generator
+ * (C++23) is not available. Lazily started, single-pass, move-only; an
+ * exception thrown in the coroutine body is rethrown from the iterator.
+ */
+template<typename T>
+class TGeneratorFallback {
+public:
+    struct promise_type {
+        const T*           value_{};
+        std::exception_ptr exception_;
+
+        TGeneratorFallback get_return_object() {
+            return TGeneratorFallback(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(const T& value) noexcept {
+            value_ = std::addressof(value);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { exception_ = std::current_exception(); }
+
+        template<typename U>
+        std::suspend_never await_transform(U&&) = delete;
+    };
+
+    class iterator {
+        std::coroutine_handle<promise_type> handle_;
+
+        void advance() {
+            handle_.resume();
+            if (handle_.done() && handle_.promise().exception_)
+                std::rethrow_exception(std::exchange(handle_.promise().exception_, nullptr));
+        }
+
+        friend class TGeneratorFallback;
+        explicit iterator(std::coroutine_handle<promise_type> handle) : handle_(handle) { advance(); }
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = T;
+
+        iterator() = default;
+
+        const T& operator*() const { return *handle_.promise().value_; }
+        const T* operator->() const { return handle_.promise().value_; }
+
+        iterator& operator++() { advance(); return *this; }
+        void operator++(int) { advance(); }
+
+        bool operator==(std::default_sentinel_t) const { return !handle_ || handle_.done(); }
+    };
+
+    TGeneratorFallback(TGeneratorFallback&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    TGeneratorFallback& operator=(TGeneratorFallback&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~TGeneratorFallback() { if (handle_) handle_.destroy(); }
+
+    /// Starts the coroutine. Call once.
+    iterator begin() { return iterator(handle_); }
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+    explicit TGeneratorFallback(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+};
+
+/**
+ * Awaitable returned by the @c TTranscoderT::*Async() methods.
+ *
+ * Suspends the awaiting coroutine, hands @p op to the executor and resumes
+ * the coroutine on whichever thread the executor ran it, yielding the
+ * operation's @c bool result. The executor is any callable accepting a
+ * nullary move-only function object, e.g. a thread pool's @c post.
+ */
+template<typename Executor, typename Op>
+class TTranscoderAwaitable {
+    Executor executor_;
+    Op       op_;
+    bool     result_ = false;
+
+public:
+    TTranscoderAwaitable(Executor executor, Op op) : executor_(std::move(executor)), op_(std::move(op)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        // Move the executor out first: with an inline executor the coroutine may
+        // resume and destroy this awaitable before the call returns.
+        Executor executor = std::move(executor_);
+        executor([this, handle]() mutable {
+            result_ = op_();
+            handle.resume();
+        });
+    }
+
+    bool await_resume() const noexcept { return result_; }
+};
+
+} // namespace detail
+
+/// Generator type returned by @c TTranscoderT::samples(): @c std::generator when the
+/// standard library provides it (C++23), otherwise a minimal C++20 equivalent.
+#if defined(__cpp_lib_generator)
+template<typename T>
+using TGenerator = std::generator<T>;
+#else
+template<typename T>
+using TGenerator = detail::TGeneratorFallback<T>;
+#endif
+
 /**
  * Internal adapter that bridges @c std::function callbacks to the raw
  * @c primo::avblocks::TranscoderCallback interface.
@@ -1468,12 +2862,256 @@ public:
     }
 };
 
+// ---- Statically dispatched callbacks ----------------------------------------
+
+/**
+ * Lets a callable through at most once per interval.
+ *
+ * Used by the throttled handlers in @c callback, and usable on its own inside
+ * any progress lambda. An interval of zero lets every call through.
+ */
+class TRateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TRateLimiter(Clock::duration interval = {}) : interval_(interval) {}
+
+    /// Returns @c true if at least one interval has passed since the last @c true.
+    bool ready() {
+        if (interval_ == Clock::duration::zero())
+            return true;
+        Clock::time_point now = Clock::now();
+        if (now < next_)
+            return false;
+        next_ = now + interval_;
+        return true;
+    }
+
+    /// Makes the next @c ready() return @c true.
+    void reset() { next_ = {}; }
+
+    Clock::duration interval() const { return interval_; }
+
+private:
+    Clock::duration   interval_;
+    Clock::time_point next_{};
+};
+
+/**
+ * Handler factories for @c TTranscoderT::callbacks().
+ *
+ * Each factory tags a callable with the event it handles. The handlers are
+ * stored by value inside the adapter and called directly; there is no
+ * @c std::function and no allocation beyond the adapter itself.
+ */
+namespace callback {
+
+/// No-op defaults that the handlers below hide with their own event.
+struct THandlerBase {
+    void progress(double, double) {}
+    void status(primo::avblocks::TranscoderStatus::Enum) {}
+    bool proceed(double) { return true; }
+    void inputChange(int32_t) {}
+};
+
+template<typename F>
+struct TProgressHandler : THandlerBase {
+    F            f;
+    TRateLimiter limiter;
+
+    void progress(double current, double total) {
+        // The final tick always goes through so a UI can show 100%.
+        if (limiter.ready() || (total > 0 && current >= total))
+            f(current, total);
+    }
+};
+
+template<typename F>
+struct TStatusHandler : THandlerBase {
+    F f;
+    void status(primo::avblocks::TranscoderStatus::Enum s) { f(s); }
+};
+
+template<typename F>
+struct TContinueHandler : THandlerBase {
+    F            f;
+    TRateLimiter limiter;
+    bool         last = true;
+
+    bool proceed(double current) {
+        if (limiter.ready())
+            last = static_cast<bool>(f(current));
+        return last;
+    }
+};
+
+template<typename F>
+struct TInputChangeHandler : THandlerBase {
+    F f;
+    void inputChange(int32_t index) { f(index); }
+};
+
+/// Handles @c onProgress(current, total). With a non-zero @p interval the
+/// callable fires at most once per interval, plus once on the final tick.
+template<typename F>
+TProgressHandler<std::decay_t<F>> progress(F&& f, TRateLimiter::Clock::duration interval = {}) {
+    return { {}, std::forward<F>(f), TRateLimiter(interval) };
+}
+
+/// Handles @c onStatus(status).
+template<typename F>
+TStatusHandler<std::decay_t<F>> status(F&& f) {
+    return { {}, std::forward<F>(f) };
+}
+
+/// Handles @c onContinue(current); return @c false to stop @c run(). With a
+/// non-zero @p interval the callable is asked at most once per interval and
+/// its last answer is reused in between.
+template<typename F>
+TContinueHandler<std::decay_t<F>> shouldContinue(F&& f, TRateLimiter::Clock::duration interval = {}) {
+    return { {}, std::forward<F>(f), TRateLimiter(interval) };
+}
+
+/// Handles @c onInputChange(inputIndex).
+template<typename F>
+TInputChangeHandler<std::decay_t<F>> inputChange(F&& f) {
+    return { {}, std::forward<F>(f) };
+}
+
+} // namespace callback
+
+namespace detail {
+
+/// Common base of the callback adapters so @c TTranscoderT can own either kind.
+class TCallbackBase : public primo::avblocks::TranscoderCallback {
+public:
+    virtual ~TCallbackBase() = default;
+};
+
+/// @c TranscoderCallback that forwards each event to every handler in @p Handlers.
+template<typename... Handlers>
+class TStaticCallback final : public TCallbackBase {
+    std::tuple<Handlers...> handlers_;
+
+public:
+    explicit TStaticCallback(Handlers... handlers) : handlers_(std::move(handlers)...) {}
+
+    void onProgress(double current, double total) override {
+        std::apply([&](auto&... h) { (h.progress(current, total), ...); }, handlers_);
+    }
+    void onStatus(primo::avblocks::TranscoderStatus::Enum s) override {
+        std::apply([&](auto&... h) { (h.status(s), ...); }, handlers_);
+    }
+    bool_t onContinue(double current) override {
+        bool proceed = true;
+        std::apply([&](auto&... h) { ((proceed = h.proceed(current) && proceed), ...); }, handlers_);
+        return proceed ? TRUE : FALSE;
+    }
+    void onInputChange(int32_t index) override {
+        std::apply([&](auto&... h) { (h.inputChange(index), ...); }, handlers_);
+    }
+};
+
+} // namespace detail
+
+// ---- Cancellable runs --------------------------------------------------------
+
+/// How a cancellable @c TTranscoderT::run() overload ended.
+struct TRunStatus {
+    enum Enum {
+        Completed = 0,  ///< @c run() finished on its own.
+        Stopped   = 1,  ///< Stop was requested through the @c std::stop_token.
+        TimedOut  = 2,  ///< The deadline passed.
+        Failed    = 3   ///< @c run() failed; see @c TRunResult::error.
+    };
+};
+
+/// Result of the cancellable @c run() overloads, including how far the job got.
+struct TRunResult {
+    TRunStatus::Enum status      = TRunStatus::Completed;
+    double           currentTime = 0;   ///< Last position reported by the SDK, in seconds.
+    double           totalTime   = 0;   ///< Total duration reported by the SDK, 0 if unknown.
+    TErrorCode       error;             ///< Set when @c status is @c Failed.
+
+    bool completed() const { return status == TRunStatus::Completed; }
+
+    /// Fraction done in [0, 1], or 0 if the total is unknown.
+    double progress() const {
+        return totalTime > 0 ? std::min(currentTime / totalTime, 1.0) : 0.0;
+    }
+};
+
+namespace detail {
+
+/**
+ * Temporary @c TranscoderCallback installed for one cancellable @c run().
+ * Forwards every event to the callback that was installed before, records
+ * progress, and ends the run once @p shouldStop returns @c true.
+ */
+template<typename ShouldStop>
+class TStopCallback final : public primo::avblocks::TranscoderCallback {
+    primo::avblocks::TranscoderCallback* inner_;
+    ShouldStop                           shouldStop_;
+
+public:
+    double currentTime = 0;
+    double totalTime   = 0;
+    bool   stopped     = false;
+
+    TStopCallback(primo::avblocks::TranscoderCallback* inner, ShouldStop shouldStop)
+        : inner_(inner), shouldStop_(std::move(shouldStop)) {}
+
+    void onProgress(double current, double total) override {
+        currentTime = current;
+        totalTime   = total;
+        if (inner_) inner_->onProgress(current, total);
+    }
+    void onStatus(primo::avblocks::TranscoderStatus::Enum s) override {
+        if (inner_) inner_->onStatus(s);
+    }
+    bool_t onContinue(double current) override {
+        currentTime = current;
+        if (shouldStop_()) {
+            stopped = true;
+            return FALSE;
+        }
+        return inner_ ? inner_->onContinue(current) : TRUE;
+    }
+    void onInputChange(int32_t index) override {
+        if (inner_) inner_->onInputChange(index);
+    }
+};
+
+} // namespace detail
+
+/// Returns @c true for output containers whose writer seeks back to patch
+/// headers or indexes (MP4, AVI, ASF, WAVE, IVF), and therefore cannot be
+/// written to a non-seekable stream such as a pipe. Use MPEG-TS, WebM, Ogg
+/// or elementary streams there instead.
+inline bool requiresSeekableOutput(primo::codecs::StreamType::Enum container) {
+    using primo::codecs::StreamType;
+    switch (container) {
+        case StreamType::MP4:
+        case StreamType::AVI:
+        case StreamType::ASF:
+        case StreamType::WAVE:
+        case StreamType::IVF:
+            return true;
+        default:
+            return false;
+    }
+}
+
 template<typename CharT = char>
 class TTranscoderT {
-    // callback_ must be declared BEFORE transcoder_ so that it is destroyed
-    // AFTER the raw Transcoder (which holds a raw pointer to the callback).
-    std::unique_ptr<TTranscoderCallback>   callback_;
+    // callback_ and staticCallback_ must be declared BEFORE transcoder_ so that they
+    // are destroyed AFTER the raw Transcoder (which holds a raw pointer to the callback).
+    std::unique_ptr<TTranscoderCallback>    callback_;
+    std::unique_ptr<detail::TCallbackBase>  staticCallback_;
     primo::ref<primo::avblocks::Transcoder> transcoder_;
+    /// Set when the seekable-output check of @c open() fails; reported by
+    /// @c error() / @c errorCode() instead of the SDK error until the next open.
+    std::optional<TErrorInfo>               openError_;
     
 public:
     TTranscoderT() 
@@ -1488,15 +3126,44 @@ public:
     TTranscoderT& operator=(TTranscoderT&&) = default;
     
     /// Returns the callback adapter, creating and installing it on first use.
+    /// Replaces an adapter installed by @c callbacks(), if any.
     TTranscoderCallback& ensureCallback() {
         if (!callback_) {
             callback_ = std::make_unique<TTranscoderCallback>();
             transcoder_->setCallback(callback_.get());
         }
+        if (staticCallback_) {
+            transcoder_->setCallback(callback_.get());
+            staticCallback_.reset();
+        }
         return *callback_;
     }
 
-    TTranscoderT& allowDemoMode(bool allow = true) {
+    /**
+     * Installs handlers built with the @c callback factories, stored inline
+     * and called without type erasure. Replaces any lambdas set with
+     * @c onProgress() / @c onStatus() / @c onContinue() / @c onInputChange();
+     * setting one of those afterwards replaces these handlers in turn.
+     *
+     * @code
+     * transcoder.callbacks(
+     *     callback::progress([&](double cur, double total) { bar.update(cur / total); },
+     *                        std::chrono::milliseconds(250)),
+     *     callback::shouldContinue([&](double) { return !cancelled; }));
+     * @endcode
+     */
+    template<typename... Handlers>
+    TTranscoderT& callbacks(Handlers&&... handlers) {
+        static_assert((std::is_base_of_v<callback::THandlerBase, std::decay_t<Handlers>> && ...),
+                      "callbacks() takes handlers made by callback::progress(), status(), shouldContinue() or inputChange()");
+        auto adapter = std::make_unique<detail::TStaticCallback<std::decay_t<Handlers>...>>(
+            std::forward<Handlers>(handlers)...);
+        transcoder_->setCallback(adapter.get());
+        staticCallback_ = std::move(adapter);
+        return *this;
+    }
+
+    TTranscoderT& allowDemoMode(bool allow = true) {
         transcoder_->setAllowDemoMode(allow ? TRUE : FALSE);
         return *this;
     }
@@ -1525,7 +3192,23 @@ public:
         ensureCallback().setOnInputChange(std::move(f));
         return *this;
     }
-    
+
+    /// Removes every lambda set by @c onProgress(), @c onStatus(), @c onContinue() and @c onInputChange(),
+    /// and any handlers installed by @c callbacks().
+    TTranscoderT& clearCallbacks() {
+        if (staticCallback_) {
+            transcoder_->setCallback(callback_.get());
+            staticCallback_.reset();
+        }
+        if (callback_) {
+            callback_->setOnProgress(nullptr);
+            callback_->setOnStatus(nullptr);
+            callback_->setOnContinue(nullptr);
+            callback_->setOnInputChange(nullptr);
+        }
+        return *this;
+    }
+
     TTranscoderT& addInput(const TMediaSocketT<CharT>& socket) {
         transcoder_->inputs()->add(socket.get());
         return *this;
@@ -1564,16 +3247,31 @@ public:
         return TMediaSocketT<CharT>(transcoder_->outputs()->at(index));
     }
 
+    /// Facility and code of the error @c open() reports when an output needs a
+    /// seekable stream: the OS "illegal seek" error (@c ESPIPE on POSIX,
+    /// @c ERROR_SEEK_ON_DEVICE on Windows). The hint names the output index.
+#if defined(_WIN32)
+    static constexpr int32_t unseekableOutputFacility = primo::error::ErrorFacility::SystemWindows;
+    static constexpr int32_t unseekableOutputCode     = 132; // ERROR_SEEK_ON_DEVICE
+#else
+    static constexpr int32_t unseekableOutputFacility = primo::error::ErrorFacility::SystemUnix;
+    static constexpr int32_t unseekableOutputCode     = ESPIPE;
+#endif
+
+    /// Opens the transcoder, throwing @c TAVBlocksException on failure. Fails fast,
+    /// before the SDK runs, when an output socket writes a container that
+    /// @c requiresSeekableOutput() to a non-seekable @c primo::Stream.
     TTranscoderT& open() {
-        if (!transcoder_->open()) {
-            throw TAVBlocksException("Failed to open transcoder", TErrorInfo(transcoder_->error()));
+        if (!checkSeekableOutputs() || !transcoder_->open()) {
+            throw TAVBlocksException("Failed to open transcoder", error());
         }
         return *this;
     }
 
-    /// Opens the transcoder without throwing. Returns @c true on success.
+    /// Opens the transcoder without throwing. Returns @c true on success; on failure,
+    /// including the seekable-output check of @c open(), see @c error().
     bool tryOpen() {
-        return transcoder_->open() == TRUE;
+        return checkSeekableOutputs() && transcoder_->open() == TRUE;
     }
     
     bool pull(int32_t& outputIndex, TMediaSample& sample) {
@@ -1590,12 +3288,241 @@ public:
         return transcoder_->push(inputIndex, nullptr) == TRUE;
     }
 
+    /// @name Batched push/pull
+    /// Amortize per-call overhead for streams of many small samples (e.g.
+    /// telephony PCM). Each stops at the first failure and returns how many
+    /// samples it handled; compare with the span size and check @c error()
+    /// or @c isEos() only then.
+    /// @{
+
+    /// Pushes @p samples to input @p inputIndex in order.
+    size_t pushBatch(int32_t inputIndex, std::span<TMediaSample> samples) {
+        size_t pushed = 0;
+        for (TMediaSample& sample : samples) {
+            if (!transcoder_->push(inputIndex, sample.get()))
+                break;
+            ++pushed;
+        }
+        return pushed;
+    }
+
+    /**
+     * Pushes @p samples to input @p inputIndex, first joining runs of
+     * contiguous samples into buffers of up to @p coalesceBytes taken from
+     * @p pool. For raw PCM inputs only: compressed frames must not be joined.
+     *
+     * Samples are contiguous when their flags, stream number, picture and
+     * frame types match and the next one starts where the previous one ended
+     * (unset, negative times always match). A joined sample keeps those fields,
+     * the first start time and the last end time. @p coalesceBytes is capped at
+     * @c INT32_MAX. The return value counts input samples, not SDK calls.
+     */
+    size_t pushBatch(int32_t inputIndex, std::span<TMediaSample> samples,
+                     TMediaBufferPool& pool, size_t coalesceBytes) {
+        coalesceBytes = std::min<size_t>(coalesceBytes, std::numeric_limits<int32_t>::max());
+        TMediaSample joined;
+        size_t done = 0;
+        while (done < samples.size()) {
+            size_t end   = done + 1;
+            size_t bytes = sampleBytes(samples[done]);
+            while (end < samples.size() && bytes > 0 &&
+                   contiguous(samples[end - 1], samples[end]) &&
+                   sampleBytes(samples[end]) > 0 &&
+                   bytes + sampleBytes(samples[end]) <= coalesceBytes) {
+                bytes += sampleBytes(samples[end]);
+                ++end;
+            }
+
+            primo::codecs::MediaSample* next = samples[done].get();
+            if (end - done > 1) {
+                TMediaBuffer buffer = pool.acquire(static_cast<int32_t>(bytes));
+                uint8_t* dst = buffer.start();
+                for (size_t i = done; i < end; ++i) {
+                    TMediaBufferView src = samples[i].bufferView();
+                    std::memcpy(dst, src.data(), static_cast<size_t>(src.dataSize()));
+                    dst += src.dataSize();
+                }
+                buffer.setData(0, static_cast<int32_t>(bytes));
+                joined.buffer(std::move(buffer))
+                      .startTime(samples[done].startTime())
+                      .endTime(samples[end - 1].endTime())
+                      .flags(samples[done].flags())
+                      .streamNumber(samples[done].streamNumber())
+                      .pictureType(samples[done].pictureType())
+                      .frameType(samples[done].frameType());
+                next = joined.get();
+            }
+
+            if (!transcoder_->push(inputIndex, next))
+                break;
+            done = end;
+        }
+        return done;
+    }
+
+    /// Pulls up to @c min(samples.size(), outputIndices.size()) samples, writing the
+    /// output index of @c samples[i] to @c outputIndices[i]. Use separate
+    /// @c TMediaSample objects across calls if the data must outlive the next pull.
+    size_t pullBatch(std::span<TMediaSample> samples, std::span<int32_t> outputIndices) {
+        const size_t count = std::min(samples.size(), outputIndices.size());
+        size_t pulled = 0;
+        while (pulled < count && transcoder_->pull(outputIndices[pulled], samples[pulled].get()))
+            ++pulled;
+        return pulled;
+    }
+    /// @}
+
+    /**
+     * Pulls samples until end of stream, as a coroutine range.
+     *
+     * Replaces the usual @c while(pull(...)) loop followed by an EOS check.
+     * Each item holds the output index and a view of the sample, valid until
+     * the next iteration. The range ends on @c CodecError::EOS; any other
+     * pull failure throws @c TAVBlocksException.
+     *
+     * @code
+     * for (auto [index, sample] : transcoder.samples())
+     *     out.write(sample.bytes());
+     * @endcode
+     */
+    TGenerator<TPulledSample> samples() {
+        TMediaSample sample;
+        int32_t outputIndex = 0;
+        while (pull(outputIndex, sample)) {
+            co_yield TPulledSample{ outputIndex, sample.view() };
+        }
+        if (!isEos()) {
+            throw TAVBlocksException("Failed to pull from transcoder", error());
+        }
+    }
+
+    /// @name Awaitable push/pull
+    /// Each call runs the SDK operation on @p executor and resumes the awaiting
+    /// coroutine there, so many sessions can share a few threads instead of
+    /// blocking one thread each. @p executor is any callable taking a nullary
+    /// function object (e.g. a thread pool's @c post). The transcoder and
+    /// @p sample must stay alive until the @c co_await completes.
+    /// @{
+    template<typename Executor>
+    auto pushAsync(int32_t inputIndex, TMediaSample& sample, Executor executor) {
+        auto op = [this, inputIndex, &sample] { return push(inputIndex, sample); };
+        return detail::TTranscoderAwaitable<Executor, decltype(op)>(std::move(executor), std::move(op));
+    }
+
+    template<typename Executor>
+    auto pushEosAsync(int32_t inputIndex, Executor executor) {
+        auto op = [this, inputIndex] { return pushEos(inputIndex); };
+        return detail::TTranscoderAwaitable<Executor, decltype(op)>(std::move(executor), std::move(op));
+    }
+
+    template<typename Executor>
+    auto pullAsync(int32_t& outputIndex, TMediaSample& sample, Executor executor) {
+        auto op = [this, &outputIndex, &sample] { return pull(outputIndex, sample); };
+        return detail::TTranscoderAwaitable<Executor, decltype(op)>(std::move(executor), std::move(op));
+    }
+    /// @}
+
+    /// @name Non-throwing, allocation-free variants
+    /// Select with @c std::nothrow. On failure they return the @c TErrorCode
+    /// only; call @c error() or @c TErrorCode::info() for the message text.
+    /// @{
+    TExpected<void> open(const std::nothrow_t&) {
+        if (!checkSeekableOutputs() || !transcoder_->open()) return unexpectedError(errorCode());
+        return {};
+    }
+
+    TExpected<void> run(const std::nothrow_t&) {
+        if (!transcoder_->run()) return unexpectedError(errorCode());
+        return {};
+    }
+
+    TExpected<void> push(int32_t inputIndex, TMediaSample& sample, const std::nothrow_t&) {
+        if (!transcoder_->push(inputIndex, sample.get())) return unexpectedError(errorCode());
+        return {};
+    }
+
+    /// Returns the output index of the pulled sample. At end of stream the
+    /// error has @c isEos() set.
+    TExpected<int32_t> pull(TMediaSample& sample, const std::nothrow_t&) {
+        int32_t outputIndex = 0;
+        if (!transcoder_->pull(outputIndex, sample.get())) return unexpectedError(errorCode());
+        return outputIndex;
+    }
+
+    TExpected<void> flush(const std::nothrow_t&) {
+        if (!transcoder_->flush()) return unexpectedError(errorCode());
+        return {};
+    }
+    /// @}
+
     TTranscoderT& run() {
         if (!transcoder_->run()) {
             throw TAVBlocksException("Failed to run transcoder", TErrorInfo(transcoder_->error()));
         }
         return *this;
     }
+
+    /// Runs the transcoder without throwing. Returns @c true on success.
+    bool tryRun() {
+        return transcoder_->run() == TRUE;
+    }
+
+#if defined(__cpp_lib_jthread)
+    /// Runs until done or until @p token is stopped. Never throws for SDK errors;
+    /// check @c TRunResult::status. The stop is seen at the next @c onContinue tick.
+    TRunResult run(std::stop_token token) {
+        return runUnless([&token] { return token.stop_requested(); }, TRunStatus::Stopped);
+    }
+#endif
+
+    /// Runs until done or until @p deadline passes (see @c run(std::stop_token)).
+    template<typename Clock, typename Duration>
+    TRunResult run_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+        return runUnless([&deadline] { return Clock::now() >= deadline; }, TRunStatus::TimedOut);
+    }
+
+    /// Runs for at most @p timeout (see @c run(std::stop_token)).
+    template<typename Rep, typename Period>
+    TRunResult run_for(const std::chrono::duration<Rep, Period>& timeout) {
+        return run_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    /// Runs until done or until @p shouldStop returns @c true, reporting
+    /// @p stopStatus in that case. Callbacks installed with @c onXxx() or
+    /// @c callbacks() keep receiving every event during the run.
+    template<typename ShouldStop>
+    TRunResult runUnless(ShouldStop shouldStop, TRunStatus::Enum stopStatus = TRunStatus::Stopped) {
+        TRunResult result;
+        if (shouldStop()) {
+            result.status = stopStatus;
+            return result;
+        }
+
+        primo::avblocks::TranscoderCallback* installed =
+            staticCallback_ ? static_cast<primo::avblocks::TranscoderCallback*>(staticCallback_.get())
+                            : callback_.get();
+        detail::TStopCallback<ShouldStop> stop(installed, std::move(shouldStop));
+
+        // Restores the previous callback even if a user handler throws through run().
+        struct Restore {
+            primo::avblocks::Transcoder*         transcoder;
+            primo::avblocks::TranscoderCallback* callback;
+            ~Restore() { transcoder->setCallback(callback); }
+        } restore{ transcoder_.get(), installed };
+
+        transcoder_->setCallback(&stop);
+        bool ran = transcoder_->run() == TRUE;
+
+        result.currentTime = stop.currentTime;
+        result.totalTime   = stop.totalTime;
+        if (stop.stopped) {
+            result.status = stopStatus;
+        } else if (!ran) {
+            result.status = TRunStatus::Failed;
+            result.error  = errorCode();
+        }
+        return result;
+    }
     
     void close() {
         transcoder_->close();
@@ -1606,14 +3533,2103 @@ public:
     }
 
     TErrorInfo error() const {
+        if (openError_) return *openError_;
         return TErrorInfo(transcoder_->error());
     }
+
+    /// Returns the last error's facility and code without copying its message.
+    TErrorCode errorCode() const {
+        if (openError_) return TErrorCode(openError_->facility(), openError_->code());
+        return TErrorCode(transcoder_->error());
+    }
+
+    /// Returns @c true when the last failed @c pull() hit end of stream. Cheap: no strings are copied.
+    bool isEos() const {
+        return errorCode().isEos();
+    }
+
+    /// Returns @c true when the last failed @c pull() only wants more input. Cheap: no strings are copied.
+    bool needsInput() const {
+        return errorCode().needsInput();
+    }
     
     primo::avblocks::Transcoder* get() const { return transcoder_.get(); }
+
+private:
+    /// Index of the first output that writes a seek-requiring container to a
+    /// non-seekable stream, or -1. Shared by every @c open() overload.
+    int32_t unseekableOutput() const {
+        primo::avblocks::MediaSocketList* outputs = transcoder_->outputs();
+        for (int32_t i = 0; i < outputs->count(); ++i) {
+            primo::avblocks::MediaSocket* socket = outputs->at(i);
+            primo::Stream* stream = socket->stream();
+            if (stream && !stream->canSeek() && requiresSeekableOutput(socket->streamType()))
+                return i;
+        }
+        return -1;
+    }
+
+    /// Runs the seekable-output check for every @c open() overload. Clears the
+    /// previous check's error; on failure stores the new one and returns @c false.
+    bool checkSeekableOutputs() {
+        openError_.reset();
+        const int32_t output = unseekableOutput();
+        if (output < 0)
+            return true;
+        openError_ = TErrorInfo(unseekableOutputFacility, unseekableOutputCode,
+                                "Container needs a seekable stream, but the stream cannot seek",
+                                "output " + std::to_string(output));
+        return false;
+    }
+
+    static size_t sampleBytes(const TMediaSample& sample) {
+        TMediaBufferView view = sample.bufferView();
+        return view.valid() ? static_cast<size_t>(view.dataSize()) : 0;
+    }
+
+    static bool contiguous(const TMediaSample& prev, const TMediaSample& next) {
+        if (prev.flags()        != next.flags()        ||
+            prev.streamNumber() != next.streamNumber() ||
+            prev.pictureType()  != next.pictureType()  ||
+            prev.frameType()    != next.frameType())
+            return false;
+        if (prev.endTime() < 0 || next.startTime() < 0)
+            return true;
+        return std::abs(next.startTime() - prev.endTime()) < 1e-6;
+    }
 };
 
 // Type aliases for convenience
 using TTranscoder = TTranscoderT<char>;
 using TTranscoderW = TTranscoderT<wchar_t>;
 
+// ---- In-memory streams ------------------------------------------------------
+
+namespace detail {
+
+/// Intrusive reference count for wrapper-side implementations of SDK interfaces.
+/// Objects start with one reference, which a @c primo::ref adopts.
+template<typename Interface>
+class TRefCounted : public Interface {
+    std::atomic<int32_t> refs_{1};
+
+public:
+    int32_t retain() override {
+        return refs_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    int32_t release() override {
+        const int32_t left = refs_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        if (left == 0)
+            delete this;
+        return left;
+    }
+
+    int32_t retainCount() const override {
+        return refs_.load(std::memory_order_relaxed);
+    }
+
+protected:
+    TRefCounted() = default;
+    virtual ~TRefCounted() = default;
+};
+
+} // namespace detail
+
+/**
+ * Growable, seekable in-memory @c primo::Stream.
+ *
+ * Use it as an output socket's stream to transcode into memory; seeking
+ * lets muxers that rewrite headers at the end (MP4 @c moov) work as they do
+ * with files. It can also serve as an input holding its own copy of the
+ * data. @c open() rewinds to the start but keeps the contents; call
+ * @c clear() to reuse the stream for a new output.
+ *
+ * Reference counted like SDK objects: create it with @c create() and
+ * pass @c get() to @c TMediaSocket::stream(). Not thread-safe; read the
+ * contents after the transcoder has closed the stream.
+ *
+ * @code
+ * auto out = TMemoryStream::create();
+ * TTranscoder()
+ *     .addInput(TMediaSocket().file("in.wav"))
+ *     .addOutput(TMediaSocket(Preset::Audio::Generic::M4A::AAC).stream(out.get()))
+ *     .open().run();
+ * std::vector<std::byte> bytes = out->take();
+ * @endcode
+ */
+class TMemoryStream final : public detail::TRefCounted<primo::Stream> {
+    std::vector<std::byte> data_;
+    size_t                 position_ = 0;
+    bool                   open_     = false;
+
+    TMemoryStream() = default;
+    explicit TMemoryStream(std::vector<std::byte> data) : data_(std::move(data)) {}
+
+public:
+    /// Creates an empty stream.
+    static primo::ref<TMemoryStream> create() {
+        return primo::ref<TMemoryStream>(new TMemoryStream());
+    }
+
+    /// Creates a stream holding @p data, e.g. as a transcoder input.
+    static primo::ref<TMemoryStream> create(std::vector<std::byte> data) {
+        return primo::ref<TMemoryStream>(new TMemoryStream(std::move(data)));
+    }
+
+    bool_t isOpen() const override { return open_; }
+
+    bool_t open() override {
+        open_     = true;
+        position_ = 0;
+        return TRUE;
+    }
+
+    void close() override { open_ = false; }
+
+    bool_t canRead()  const override { return TRUE; }
+    bool_t canWrite() const override { return TRUE; }
+    bool_t canSeek()  const override { return TRUE; }
+
+    bool_t read(void* buffer, int32_t bufferSize, int32_t* totalRead) override {
+        if (!open_ || bufferSize < 0 || !totalRead)
+            return FALSE;
+        const size_t available = position_ < data_.size() ? data_.size() - position_ : 0;
+        const size_t count     = std::min(available, static_cast<size_t>(bufferSize));
+        if (count > 0)
+            std::memcpy(buffer, data_.data() + position_, count);
+        position_ += count;
+        *totalRead = static_cast<int32_t>(count);
+        return TRUE;
+    }
+
+    bool_t write(const void* buffer, int32_t dataSize) override {
+        if (!open_ || dataSize < 0)
+            return FALSE;
+        const size_t count = static_cast<size_t>(dataSize);
+        if (position_ + count > data_.size()) {
+            // Geometric growth; resize() alone may reallocate on every small append.
+            if (position_ + count > data_.capacity())
+                data_.reserve(std::max(position_ + count, data_.capacity() * 2));
+            data_.resize(position_ + count);
+        }
+        if (count > 0)
+            std::memcpy(data_.data() + position_, buffer, count);
+        position_ += count;
+        return TRUE;
+    }
+
+    int64_t size()     const override { return static_cast<int64_t>(data_.size()); }
+    int64_t position() const override { return static_cast<int64_t>(position_); }
+
+    /// Moves the cursor. Seeking past the end is allowed; a later write fills the gap with zeros.
+    bool_t seek(int64_t position) override {
+        if (position < 0)
+            return FALSE;
+        position_ = static_cast<size_t>(position);
+        return TRUE;
+    }
+
+    /// Pre-allocates room for @p bytes so writes up to that size do not reallocate.
+    void reserve(size_t bytes) { data_.reserve(bytes); }
+
+    /// Drops the contents and rewinds.
+    void clear() {
+        data_.clear();
+        position_ = 0;
+    }
+
+    /// Contents written so far.
+    std::span<const std::byte> bytes() const { return data_; }
+
+    /// Moves the contents out, leaving the stream empty.
+    std::vector<std::byte> take() {
+        position_ = 0;
+        return std::exchange(data_, {});
+    }
+};
+
+/**
+ * Read-only, seekable @c primo::Stream over caller-owned bytes, without copying.
+ *
+ * The memory must stay valid and unchanged for as long as the stream is
+ * in use, i.e. until the transcoder (or media info) reading it is closed.
+ * Reference counted like @c TMemoryStream.
+ */
+class TSpanInputStream final : public detail::TRefCounted<primo::Stream> {
+    std::span<const std::byte> data_;
+    size_t                     position_ = 0;
+    bool                       open_     = false;
+
+    explicit TSpanInputStream(std::span<const std::byte> data) : data_(data) {}
+
+public:
+    static primo::ref<TSpanInputStream> create(std::span<const std::byte> data) {
+        return primo::ref<TSpanInputStream>(new TSpanInputStream(data));
+    }
+
+    bool_t isOpen() const override { return open_; }
+
+    bool_t open() override {
+        open_     = true;
+        position_ = 0;
+        return TRUE;
+    }
+
+    void close() override { open_ = false; }
+
+    bool_t canRead()  const override { return TRUE; }
+    bool_t canWrite() const override { return FALSE; }
+    bool_t canSeek()  const override { return TRUE; }
+
+    bool_t read(void* buffer, int32_t bufferSize, int32_t* totalRead) override {
+        if (!open_ || bufferSize < 0 || !totalRead)
+            return FALSE;
+        const size_t available = position_ < data_.size() ? data_.size() - position_ : 0;
+        const size_t count     = std::min(available, static_cast<size_t>(bufferSize));
+        if (count > 0)
+            std::memcpy(buffer, data_.data() + position_, count);
+        position_ += count;
+        *totalRead = static_cast<int32_t>(count);
+        return TRUE;
+    }
+
+    bool_t write(const void*, int32_t) override { return FALSE; }
+
+    int64_t size()     const override { return static_cast<int64_t>(data_.size()); }
+    int64_t position() const override { return static_cast<int64_t>(position_); }
+
+    bool_t seek(int64_t position) override {
+        if (position < 0 || static_cast<uint64_t>(position) > data_.size())
+            return FALSE;
+        position_ = static_cast<size_t>(position);
+        return TRUE;
+    }
+};
+
+/**
+ * Transcodes an in-memory file into memory, without temporary files.
+ *
+ * The input format is detected with @c TMediaInfo, as for a file input.
+ * @p output describes the target format (e.g. a preset socket); its stream
+ * is replaced by a @c TMemoryStream. Throws @c TAVBlocksException if the
+ * input cannot be recognized or the transcoder fails.
+ *
+ * @code
+ * std::vector<std::byte> m4a =
+ *     transcode(upload, TMediaSocket(Preset::Audio::Generic::M4A::AAC));
+ * @endcode
+ */
+inline std::vector<std::byte> transcode(std::span<const std::byte> input, TMediaSocket&& output,
+                                        bool allowDemoMode = false) {
+    auto source = TSpanInputStream::create(input);
+
+    TMediaInfo info;
+    info.inputs(0).stream(source.get());
+    info.open();
+
+    TMediaSocket inputSocket(info);
+    inputSocket.stream(source.get());
+
+    auto sink = TMemoryStream::create();
+    output.stream(sink.get());
+
+    TTranscoder transcoder;
+    transcoder.allowDemoMode(allowDemoMode)
+              .addInput(inputSocket)
+              .addOutput(output)
+              .open()
+              .run();
+    transcoder.close();
+    return sink->take();
+}
+
+// ---- Transcoder session reuse ------------------------------------------------
+
+/**
+ * Returns a normalized fingerprint of an output socket's configuration.
+ *
+ * Covers the socket's stream type and sub-type and, for each pin, the
+ * connection ID, media/stream type, bitrate settings and the audio or video
+ * format fields. The file path and any attached @c primo::Stream are left out,
+ * so two jobs that write the same format to different destinations share a
+ * fingerprint. Pin parameters set with @c TMediaPin::addParam() cannot be read
+ * back from the SDK; pass a distinguishing @c salt to
+ * @c TTranscoderPoolT::acquire() when they vary between jobs.
+ */
+template<typename CharT>
+std::string outputFingerprint(const TMediaSocketT<CharT>& socket) {
+    auto field = [](std::string& out, char tag, auto value) {
+        out += tag;
+        out += std::to_string(value);
+    };
+
+    std::string key;
+    field(key, 's', static_cast<int>(socket.streamType()));
+    field(key, '/', static_cast<int>(socket.streamSubType()));
+
+    TMediaPinList pins = socket.pins();
+    for (int32_t i = 0; i < pins.count(); ++i) {
+        TMediaPin pin = pins.at(i);
+        field(key, '|', pin.connection());
+
+        TDataStreamInfo info = pin.streamInfo();
+        if (!info.get())
+            continue;
+        field(key, 'm', static_cast<int>(info.mediaType()));
+        field(key, 't', static_cast<int>(info.streamType()));
+        field(key, '/', static_cast<int>(info.streamSubType()));
+        field(key, 'b', info.bitrate());
+        field(key, '/', info.bitrateMode());
+
+        if (info.mediaType() == primo::codecs::MediaType::Audio) {
+            TAudioStreamInfoView audio = pin.audioStreamInfoView();
+            field(key, 'c', audio.channels());
+            field(key, 'r', audio.sampleRate());
+            field(key, 'p', audio.bitsPerSample());
+            field(key, 'f', audio.pcmFlags());
+            field(key, 'l', audio.channelLayout());
+        } else if (info.mediaType() == primo::codecs::MediaType::Video) {
+            TVideoStreamInfoView video = pin.videoStreamInfoView();
+            field(key, 'w', video.frameWidth());
+            field(key, 'h', video.frameHeight());
+            field(key, 'c', static_cast<int>(video.colorFormat()));
+            field(key, 'r', video.frameRate());
+            field(key, 'i', static_cast<int>(video.scanType()));
+            field(key, 'd', video.displayRatioWidth());
+            field(key, ':', video.displayRatioHeight());
+        }
+    }
+    return key;
+}
+
+/**
+ * Keeps configured transcoders warm between short jobs with identical outputs.
+ *
+ * @c acquire() fingerprints the requested output sockets (see
+ * @c outputFingerprint()) and hands out a @c Lease on a transcoder that
+ * already has matching outputs. On a warm hit only the output destinations
+ * are swapped in; the caller adds the job's input, then calls
+ * @c Lease::open() and @c run(). When the lease ends the transcoder is
+ * closed, its inputs and callbacks are cleared and it goes back to the pool.
+ *
+ * AVBlocks rebuilds its codec graph inside @c open(), so a warm open saves
+ * transcoder creation and socket/pin/preset configuration, not the encoder
+ * initialisation itself. @c stats() reports cold and warm open latency
+ * separately so the saving can be measured for a given workload.
+ *
+ * Thread-safe. The pool must outlive every lease it hands out.
+ *
+ * @code
+ * TTranscoderPool pool;
+ * for (auto& clip : clips) {
+ *     auto job = pool.acquire(makeOutputs(clip.outputPath));
+ *     job->addInput(TMediaSocket().file(clip.inputPath));
+ *     job.open();
+ *     job->run();
+ * }
+ * auto s = pool.stats();   // s.meanColdOpen() vs s.meanWarmOpen()
+ * @endcode
+ */
+template<typename CharT = char>
+class TTranscoderPoolT {
+public:
+    using Transcoder = TTranscoderT<CharT>;
+    using Socket     = TMediaSocketT<CharT>;
+    using Clock      = std::chrono::steady_clock;
+
+    /// Open-latency counters, split by whether the transcoder was reused.
+    struct Stats {
+        uint64_t         coldOpens = 0;
+        uint64_t         warmOpens = 0;
+        Clock::duration  coldOpenTime{};
+        Clock::duration  warmOpenTime{};
+
+        Clock::duration meanColdOpen() const { return coldOpens ? coldOpenTime / static_cast<Clock::rep>(coldOpens) : Clock::duration{}; }
+        Clock::duration meanWarmOpen() const { return warmOpens ? warmOpenTime / static_cast<Clock::rep>(warmOpens) : Clock::duration{}; }
+    };
+
+    /**
+     * Exclusive use of one pooled transcoder. Move-only; returns the
+     * transcoder to the pool on destruction unless @c discard() was called
+     * or @c open() failed.
+     */
+    class Lease {
+        friend class TTranscoderPoolT;
+
+        TTranscoderPoolT*           pool_{};
+        std::string                 key_;
+        std::unique_ptr<Transcoder> transcoder_;
+        bool                        warm_ = false;
+        bool                        reusable_ = true;
+        Clock::duration             openTime_{};
+
+        Lease(TTranscoderPoolT* pool, std::string key, std::unique_ptr<Transcoder> transcoder, bool warm)
+            : pool_(pool), key_(std::move(key)), transcoder_(std::move(transcoder)), warm_(warm) {}
+
+    public:
+        Lease() = default;
+        ~Lease() { release(); }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        Lease(Lease&& other) noexcept = default;
+
+        Lease& operator=(Lease&& other) noexcept {
+            if (this != &other) {
+                release();
+                pool_       = std::exchange(other.pool_, nullptr);
+                key_        = std::move(other.key_);
+                transcoder_ = std::move(other.transcoder_);
+                warm_       = other.warm_;
+                reusable_   = other.reusable_;
+                openTime_   = other.openTime_;
+            }
+            return *this;
+        }
+
+        Transcoder& transcoder() const { return *transcoder_; }
+        Transcoder& operator*()  const { return *transcoder_; }
+        Transcoder* operator->() const { return transcoder_.get(); }
+
+        /// Returns @c true if the transcoder came from the pool rather than being created for this lease.
+        bool warm() const { return warm_; }
+
+        /// Returns the latency of the last @c open() / @c tryOpen() call.
+        Clock::duration openTime() const { return openTime_; }
+
+        /// Opens the transcoder and records the latency. Throws @c TAVBlocksException on failure.
+        Lease& open() {
+            if (!tryOpen()) {
+                throw TAVBlocksException("Failed to open transcoder", transcoder_->error());
+            }
+            return *this;
+        }
+
+        /// Opens the transcoder without throwing and records the latency. Returns @c true on success.
+        /// A transcoder that fails to open is not returned to the pool.
+        bool tryOpen() {
+            auto start = Clock::now();
+            bool ok = transcoder_->tryOpen();
+            openTime_ = Clock::now() - start;
+            if (ok) {
+                pool_->record(warm_, openTime_);
+            } else {
+                reusable_ = false;
+            }
+            return ok;
+        }
+
+        /// Drops the transcoder instead of returning it to the pool (e.g. after a failed run).
+        void discard() { reusable_ = false; }
+
+        /// Closes the transcoder and returns it to the pool. Called by the destructor.
+        void release() {
+            if (!transcoder_)
+                return;
+            std::unique_ptr<Transcoder> transcoder = std::move(transcoder_);
+            transcoder->close();
+            if (!reusable_)
+                return;
+            transcoder->inputs().clear();
+            transcoder->clearCallbacks();
+            TMediaSocketList outputs = transcoder->outputs();
+            for (int32_t i = 0; i < outputs.count(); ++i) {
+                outputs.at(i).stream(nullptr);
+            }
+            pool_->giveBack(std::move(key_), std::move(transcoder));
+        }
+    };
+
+    /// Creates a pool keeping at most @p maxIdlePerKey idle transcoders per output configuration.
+    explicit TTranscoderPoolT(size_t maxIdlePerKey = 4) : maxIdlePerKey_(maxIdlePerKey) {}
+
+    TTranscoderPoolT(const TTranscoderPoolT&) = delete;
+    TTranscoderPoolT& operator=(const TTranscoderPoolT&) = delete;
+
+    /// Sets the per-configuration idle limit (fluent). Surplus idle transcoders are dropped.
+    TTranscoderPoolT& maxIdlePerKey(size_t count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        maxIdlePerKey_ = count;
+        for (auto& [key, idle] : idle_) {
+            if (idle.size() > count)
+                idle.resize(count);
+        }
+        return *this;
+    }
+
+    size_t maxIdlePerKey() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return maxIdlePerKey_;
+    }
+
+    /**
+     * Returns a lease on a transcoder configured with @p outputs.
+     *
+     * On a warm hit the file path and @c primo::Stream of each socket in
+     * @p outputs are copied onto the pooled transcoder's outputs and
+     * @p outputs is discarded. On a miss a new transcoder is created with
+     * @p outputs as its output sockets. @p salt is folded into the key;
+     * use it for settings the fingerprint cannot see, such as pin parameters.
+     */
+    Lease acquire(std::vector<Socket> outputs, std::string_view salt = {}) {
+        std::string key(salt);
+        for (const Socket& socket : outputs) {
+            key += '#';
+            key += outputFingerprint(socket);
+        }
+
+        std::unique_ptr<Transcoder> transcoder;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = idle_.find(key);
+            if (it != idle_.end() && !it->second.empty()) {
+                transcoder = std::move(it->second.back());
+                it->second.pop_back();
+            }
+        }
+
+        if (transcoder) {
+            for (int32_t i = 0; i < static_cast<int32_t>(outputs.size()); ++i) {
+                Socket target = transcoder->outputs(i);
+                typename Socket::string_type path = outputs[i].file();
+                if (path.empty())
+                    target.file(nullptr);
+                else
+                    target.file(path);
+                target.stream(outputs[i].get()->stream());
+            }
+            return Lease(this, std::move(key), std::move(transcoder), true);
+        }
+
+        transcoder = std::make_unique<Transcoder>();
+        for (const Socket& socket : outputs) {
+            transcoder->addOutput(socket);
+        }
+        return Lease(this, std::move(key), std::move(transcoder), false);
+    }
+
+    /// Returns a snapshot of the cold/warm open counters.
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    /// Returns the number of idle transcoders across all configurations.
+    size_t idleCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = 0;
+        for (const auto& [key, idle] : idle_)
+            count += idle.size();
+        return count;
+    }
+
+    /// Drops every idle transcoder.
+    void trim() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.clear();
+    }
+
+private:
+    mutable std::mutex mutex_;
+    size_t             maxIdlePerKey_;
+    Stats              stats_;
+    std::unordered_map<std::string, std::vector<std::unique_ptr<Transcoder>>> idle_;
+
+    void record(bool warm, Clock::duration elapsed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (warm) {
+            ++stats_.warmOpens;
+            stats_.warmOpenTime += elapsed;
+        } else {
+            ++stats_.coldOpens;
+            stats_.coldOpenTime += elapsed;
+        }
+    }
+
+    void giveBack(std::string key, std::unique_ptr<Transcoder> transcoder) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& idle = idle_[std::move(key)];
+        if (idle.size() < maxIdlePerKey_)
+            idle.push_back(std::move(transcoder));
+    }
+};
+
+using TTranscoderPool  = TTranscoderPoolT<char>;
+using TTranscoderPoolW = TTranscoderPoolT<wchar_t>;
+
+// ---- Threaded pipeline -------------------------------------------------------
+
+namespace detail {
+
+/**
+ * Bounded single-producer/single-consumer ring used by @c TPipelineT.
+ *
+ * Slots are constructed once and reused. The producer fills @c back() and
+ * calls @c push(); the consumer reads @c front() and calls @c pop(). Index
+ * updates are lock-free. @c waitForSpace() / @c waitForData() spin briefly,
+ * then block on a C++20 atomic wait so an idle stage does not burn a core.
+ * @c cancel() wakes both sides and makes every wait return @c false.
+ */
+template<typename T>
+class TSpscRing {
+    std::vector<T> slots_;
+    size_t         mask_;
+
+    alignas(64) std::atomic<size_t>   head_{0};     // next slot to read
+    alignas(64) std::atomic<size_t>   tail_{0};     // next slot to write
+    alignas(64) std::atomic<uint32_t> signal_{0};
+    std::atomic<bool>                 cancelled_{false};
+
+    static size_t roundUp(size_t n) {
+        size_t size = 2;
+        while (size < n)
+            size <<= 1;
+        return size;
+    }
+
+    template<typename Ready>
+    bool waitFor(Ready ready) {
+        for (int spin = 0; spin < 64; ++spin) {
+            if (ready()) return true;
+            if (cancelled_.load(std::memory_order_relaxed)) return false;
+        }
+        for (;;) {
+            uint32_t seen = signal_.load(std::memory_order_acquire);
+            if (ready()) return true;
+            if (cancelled_.load(std::memory_order_acquire)) return false;
+            signal_.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    void notify() {
+        signal_.fetch_add(1, std::memory_order_release);
+        signal_.notify_all();
+    }
+
+public:
+    /// Creates a ring holding at least @p depth items (rounded up to a power of two).
+    explicit TSpscRing(size_t depth) : slots_(roundUp(depth)), mask_(slots_.size() - 1) {}
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    bool full() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire) == slots_.size();
+    }
+
+    /// Producer: blocks until a slot is free. Returns @c false if cancelled.
+    bool waitForSpace() { return waitFor([this] { return !full(); }); }
+
+    /// Consumer: blocks until an item is available. Returns @c false if cancelled.
+    bool waitForData() { return waitFor([this] { return !empty(); }); }
+
+    /// Producer: the slot to fill next. Valid only after @c waitForSpace() returned @c true.
+    T& back() { return slots_[tail_.load(std::memory_order_relaxed) & mask_]; }
+
+    /// Producer: publishes the slot returned by @c back().
+    void push() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        notify();
+    }
+
+    /// Consumer: the oldest item. Valid only after @c waitForData() returned @c true.
+    T& front() { return slots_[head_.load(std::memory_order_relaxed) & mask_]; }
+
+    /// Consumer: releases the slot returned by @c front() back to the producer.
+    void pop() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        notify();
+    }
+
+    /// Wakes both sides; every current and future wait returns @c false.
+    void cancel() {
+        cancelled_.store(true, std::memory_order_release);
+        notify();
+    }
+};
+
+} // namespace detail
+
+/**
+ * Runs a chain of transcoders concurrently, one worker thread per stage.
+ *
+ * Samples pulled from output @c i of stage @c k are pushed into input @c i of
+ * stage @c k+1 through a bounded lock-free SPSC ring, so decoding, filtering
+ * and encoding overlap instead of alternating in a single pull/push loop. A
+ * full ring blocks the upstream stage (backpressure); an empty one blocks the
+ * downstream stage.
+ *
+ * The first stage is driven by @c pull() only (its inputs are files or
+ * streams), the last by @c push() only (its outputs are files or streams),
+ * and middle stages by both. When a stage reaches end of stream the next one
+ * receives @c pushEos() on every input. The first stage to fail cancels all
+ * workers; @c run() then throws with that stage's error.
+ *
+ * Stages are referenced, not owned: open them before @c run() and close them
+ * afterwards, exactly as for a hand-written loop. Each transcoder is touched
+ * only by its own worker while @c run() is active.
+ *
+ * Pulled samples are copied into buffers from an internal
+ * @c TMediaBufferPool (@c detail::copySample()) before they cross threads.
+ * The copies recycle once the next stage has pushed them.
+ *
+ * @code
+ * TPipeline()
+ *     .stage(decoder)
+ *     .stage(encoder)
+ *     .run();
+ * @endcode
+ */
+template<typename CharT = char>
+class TPipelineT {
+    struct Slot {
+        TMediaSample sample;
+        int32_t      index = 0;
+        bool         eos   = false;
+    };
+    using Ring = detail::TSpscRing<Slot>;
+
+    std::vector<TTranscoderT<CharT>*>  stages_;
+    size_t                             depth_;
+    TMediaBufferPool                   pool_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+
+    std::mutex         errorMutex_;
+    std::atomic<bool>  failed_{false};
+    TErrorInfo         error_;
+    int32_t            failedStage_ = -1;
+    std::exception_ptr exception_;
+
+    void fail(size_t stage, TErrorInfo error, std::exception_ptr exception = nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(errorMutex_);
+            if (failed_.load(std::memory_order_relaxed))
+                return;
+            error_       = std::move(error);
+            failedStage_ = static_cast<int32_t>(stage);
+            exception_   = std::move(exception);
+            failed_.store(true, std::memory_order_release);
+        }
+        for (auto& ring : rings_)
+            ring->cancel();
+    }
+
+    /// Copies @p from into the next free slot of @p out. Returns @c false if cancelled.
+    bool forward(Ring& out, int32_t index, const TMediaSample& from) {
+        if (!out.waitForSpace())
+            return false;
+
+        Slot& slot = out.back();
+        detail::copySample(pool_, from, slot.sample);
+        slot.index = index;
+        slot.eos   = false;
+        out.push();
+        return true;
+    }
+
+    bool forwardEos(Ring& out) {
+        if (!out.waitForSpace())
+            return false;
+        Slot& slot = out.back();
+        slot.sample.buffer(nullptr);
+        slot.eos = true;
+        out.push();
+        return true;
+    }
+
+    struct DrainResult {
+        enum Enum {
+            /// Nothing more ready until the stage gets more input.
+            NeedsInput,
+            /// The stage reached end of stream.
+            Eos,
+            /// The stage failed (recorded with @c fail()) or the pipeline was cancelled.
+            Stopped,
+        };
+    };
+
+    /// Pulls everything stage @p k has ready into @p out.
+    typename DrainResult::Enum drain(size_t k, TTranscoderT<CharT>& transcoder, Ring& out, TMediaSample& scratch) {
+        int32_t index = 0;
+        while (transcoder.pull(index, scratch)) {
+            if (!forward(out, index, scratch))
+                return DrainResult::Stopped;
+        }
+        const TErrorCode code = transcoder.errorCode();
+        if (code.isEos())
+            return DrainResult::Eos;
+        if (code.needsInput())
+            return DrainResult::NeedsInput;
+        fail(k, transcoder.error());
+        return DrainResult::Stopped;
+    }
+
+    void runSource(size_t k) {
+        TTranscoderT<CharT>& transcoder = *stages_[k];
+        Ring& out = *rings_[k];
+        TMediaSample scratch;
+
+        int32_t index = 0;
+        while (transcoder.pull(index, scratch)) {
+            if (!forward(out, index, scratch))
+                return;
+        }
+        if (!transcoder.isEos()) {
+            fail(k, transcoder.error());
+            return;
+        }
+        forwardEos(out);
+    }
+
+    void runStage(size_t k) {
+        TTranscoderT<CharT>& transcoder = *stages_[k];
+        Ring& in  = *rings_[k - 1];
+        Ring* out = k + 1 < stages_.size() ? rings_[k].get() : nullptr;
+        TMediaSample scratch;
+        bool stageEos = false;
+
+        for (;;) {
+            if (!in.waitForData())
+                return;
+
+            Slot& slot = in.front();
+            if (slot.eos) {
+                in.pop();
+                break;
+            }
+            if (stageEos) {
+                // Stage finished early (e.g. a duration limit); keep upstream unblocked.
+                slot.sample.buffer(nullptr);
+                in.pop();
+                continue;
+            }
+
+            bool pushed = transcoder.push(slot.index, slot.sample);
+            slot.sample.buffer(nullptr);
+            in.pop();
+            if (!pushed) {
+                fail(k, transcoder.error());
+                return;
+            }
+
+            if (out) {
+                const auto drained = drain(k, transcoder, *out, scratch);
+                if (drained == DrainResult::Stopped)
+                    return;
+                if (drained == DrainResult::Eos) {
+                    stageEos = true;
+                    if (!forwardEos(*out))
+                        return;
+                }
+            }
+            if (failed_.load(std::memory_order_acquire))
+                return;
+        }
+
+        if (stageEos)
+            return;
+
+        for (int32_t i = 0; i < transcoder.inputs().count(); ++i) {
+            if (!transcoder.pushEos(i)) {
+                fail(k, transcoder.error());
+                return;
+            }
+        }
+
+        if (out) {
+            const auto drained = drain(k, transcoder, *out, scratch);
+            if (drained == DrainResult::Stopped)
+                return;
+            if (drained != DrainResult::Eos) {
+                // Every input got EOS, so a stage still asking for input is broken.
+                fail(k, transcoder.error());
+                return;
+            }
+            forwardEos(*out);
+        }
+    }
+
+public:
+    /// Creates an empty pipeline. @p depth is the capacity, in samples, of each inter-stage ring.
+    explicit TPipelineT(size_t depth = 16) : depth_(depth ? depth : 1) {}
+
+    TPipelineT(const TPipelineT&) = delete;
+    TPipelineT& operator=(const TPipelineT&) = delete;
+
+    /// Appends @p transcoder as the next stage (fluent). The transcoder must outlive @c run().
+    TPipelineT& stage(TTranscoderT<CharT>& transcoder) {
+        stages_.push_back(&transcoder);
+        return *this;
+    }
+
+    size_t stageCount() const { return stages_.size(); }
+    size_t depth()      const { return depth_; }
+
+    /// Runs every stage to end of stream. Throws @c TAVBlocksException with the
+    /// first failing stage's error, or rethrows an exception raised by a worker.
+    TPipelineT& run() {
+        if (!tryRun()) {
+            if (exception_)
+                std::rethrow_exception(exception_);
+            throw TAVBlocksException(
+                ("Pipeline stage " + std::to_string(failedStage_) + " failed").c_str(), error_);
+        }
+        return *this;
+    }
+
+    /// Runs every stage to end of stream without throwing. Returns @c true on success;
+    /// on failure @c failedStage() and @c error() describe the first stage that failed.
+    bool tryRun() {
+        if (stages_.size() < 2)
+            throw std::invalid_argument("TPipeline: at least two stages are required");
+
+        rings_.clear();
+        for (size_t k = 0; k + 1 < stages_.size(); ++k)
+            rings_.push_back(std::make_unique<Ring>(depth_));
+        failed_.store(false);
+        error_       = TErrorInfo();
+        failedStage_ = -1;
+        exception_   = nullptr;
+
+        std::vector<std::thread> workers;
+        workers.reserve(stages_.size());
+        try {
+            for (size_t k = 0; k < stages_.size(); ++k) {
+                workers.emplace_back([this, k] {
+                    try {
+                        if (k == 0)
+                            runSource(k);
+                        else
+                            runStage(k);
+                    } catch (...) {
+                        fail(k, TErrorInfo(), std::current_exception());
+                    }
+                });
+            }
+        } catch (...) {
+            // Could not start every worker: stop the ones that did start.
+            fail(workers.size(), TErrorInfo(), std::current_exception());
+        }
+        for (auto& worker : workers)
+            worker.join();
+
+        rings_.clear();
+        return !failed_.load();
+    }
+
+    /// Index of the first stage that failed during the last run, or -1.
+    int32_t failedStage() const { return failedStage_; }
+
+    /// Error reported by the first failing stage during the last run.
+    const TErrorInfo& error() const { return error_; }
+};
+
+using TPipeline  = TPipelineT<char>;
+using TPipelineW = TPipelineT<wchar_t>;
+
+// ---- Interleaving push scheduler ---------------------------------------------
+
+/**
+ * Feeds several push inputs of one muxing transcoder in timestamp order.
+ *
+ * Pushing each input in whatever order its producer delivers makes the muxer
+ * buffer the faster inputs internally, which can grow without bound when
+ * audio and video are unbalanced. The interleaver instead reads up to
+ * @c lookahead samples ahead from every source and always pushes next from
+ * the input whose earliest buffered @c startTime() is lowest. Memory stays at
+ * @c lookahead samples per source, and the muxer receives the inputs
+ * already interleaved.
+ *
+ * A lookahead above 1 lets sources in decode order (B-frames) be ranked by
+ * their earliest upcoming presentation time; samples of one input are always
+ * pushed in the order the source produced them. Samples with a negative
+ * (unknown) start time take the previous key of their input. Each input
+ * receives @c pushEos() as soon as its source is exhausted.
+ *
+ * A source must hand out samples that stay valid while they wait in the
+ * window; copy the data yourself if a function source reuses its buffers.
+ * Transcoder sources with a lookahead above 1 are copied into buffers from
+ * an internal @c TMediaBufferPool (the SDK may reuse pulled buffers); with a
+ * lookahead of 1 each sample is pushed before its source is pulled again,
+ * so no copy is made.
+ *
+ * @code
+ * TInterleaver(muxer)
+ *     .source(0, videoEncoder)
+ *     .source(1, audioEncoder)
+ *     .run();
+ * @endcode
+ */
+template<typename CharT = char>
+class TInterleaverT {
+    struct Source {
+        int32_t                                  input = 0;
+        std::function<bool(TMediaSample&)>       next;
+        std::deque<TMediaSample>                 window;
+        std::vector<TMediaSample>                spare;
+        double                                   lastKey = -std::numeric_limits<double>::infinity();
+        bool                                     exhausted = false;
+        bool                                     eosPushed = false;
+    };
+
+    TTranscoderT<CharT>& muxer_;
+    size_t               lookahead_;
+    TMediaBufferPool     pool_;
+    std::deque<Source>   sources_;  // never relocates; Source is not nothrow-movable
+    int32_t              failedInput_ = -1;
+    TErrorInfo           error_;
+
+    static TMediaSample takeSpare(Source& src) {
+        TMediaSample sample = std::move(src.spare.back());
+        src.spare.pop_back();
+        return sample;
+    }
+
+    void fill(Source& src) {
+        while (!src.exhausted && src.window.size() < lookahead_) {
+            // Reuse a spare before asking the SDK for a new sample.
+            TMediaSample sample = src.spare.empty() ? TMediaSample() : takeSpare(src);
+            if (src.next(sample))
+                src.window.push_back(std::move(sample));
+            else
+                src.exhausted = true;
+        }
+    }
+
+    double key(const Source& src) const {
+        double best = std::numeric_limits<double>::infinity();
+        for (const TMediaSample& sample : src.window) {
+            if (sample.startTime() >= 0)
+                best = std::min(best, sample.startTime());
+        }
+        return std::isinf(best) ? src.lastKey : best;
+    }
+
+    bool fail(const Source& src) {
+        failedInput_ = src.input;
+        error_       = muxer_.error();
+        return false;
+    }
+
+public:
+    /// Creates an interleaver for @p muxer, which must be open and outlive @c run().
+    /// @p lookahead is the number of samples buffered per source (at least 1).
+    explicit TInterleaverT(TTranscoderT<CharT>& muxer, size_t lookahead = 1)
+        : muxer_(muxer), lookahead_(lookahead ? lookahead : 1) {}
+
+    TInterleaverT(const TInterleaverT&) = delete;
+    TInterleaverT& operator=(const TInterleaverT&) = delete;
+
+    /// Adds a source for muxer input @p inputIndex (fluent). @p next fills the
+    /// sample it is given and returns @c true, or returns @c false at end of stream.
+    TInterleaverT& source(int32_t inputIndex, std::function<bool(TMediaSample&)> next) {
+        Source src;
+        src.input = inputIndex;
+        src.next  = std::move(next);
+        sources_.push_back(std::move(src));
+        return *this;
+    }
+
+    /// Adds @p producer as the source for muxer input @p inputIndex (fluent), pulling
+    /// until end of stream. Any other pull failure throws @c TAVBlocksException.
+    TInterleaverT& source(int32_t inputIndex, TTranscoderT<CharT>& producer) {
+        auto pulled = [&producer](TMediaSample& sample) {
+            int32_t outputIndex = 0;
+            if (producer.pull(outputIndex, sample))
+                return true;
+            if (!producer.isEos())
+                throw TAVBlocksException("Failed to pull from interleaver source", producer.error());
+            return false;
+        };
+        if (lookahead_ == 1)
+            return source(inputIndex, pulled);
+
+        auto scratch = std::make_shared<TMediaSample>();
+        return source(inputIndex, [this, pulled, scratch](TMediaSample& sample) {
+            if (!pulled(*scratch))
+                return false;
+            detail::copySample(pool_, *scratch, sample);
+            return true;
+        });
+    }
+
+    size_t sourceCount() const { return sources_.size(); }
+    size_t lookahead()   const { return lookahead_; }
+
+    /// Pushes every source to end of stream. Throws @c TAVBlocksException if the muxer rejects a push.
+    TInterleaverT& run() {
+        if (!tryRun()) {
+            throw TAVBlocksException(
+                ("Failed to push to muxer input " + std::to_string(failedInput_)).c_str(), error_);
+        }
+        return *this;
+    }
+
+    /// Like @c run(), but returns @c false when the muxer rejects a push (see
+    /// @c failedInput() and @c error()). Exceptions from sources propagate.
+    bool tryRun() {
+        failedInput_ = -1;
+        error_       = TErrorInfo();
+
+        for (Source& src : sources_)
+            fill(src);
+
+        for (;;) {
+            Source* best    = nullptr;
+            double  bestKey = 0;
+            for (Source& src : sources_) {
+                if (src.window.empty()) {
+                    if (src.exhausted && !src.eosPushed) {
+                        if (!muxer_.pushEos(src.input))
+                            return fail(src);
+                        src.eosPushed = true;
+                    }
+                    continue;
+                }
+                const double k = key(src);
+                if (!best || k < bestKey) {
+                    best    = &src;
+                    bestKey = k;
+                }
+            }
+            if (!best)
+                return true;
+
+            TMediaSample& sample = best->window.front();
+            if (!muxer_.push(best->input, sample))
+                return fail(*best);
+
+            best->lastKey = bestKey;
+            sample.buffer(nullptr);
+            best->spare.push_back(std::move(sample));
+            best->window.pop_front();
+            fill(*best);
+        }
+    }
+
+    /// Muxer input whose push failed during the last run, or -1.
+    int32_t failedInput() const { return failedInput_; }
+
+    /// Muxer error captured when a push failed during the last run.
+    const TErrorInfo& error() const { return error_; }
+};
+
+using TInterleaver  = TInterleaverT<char>;
+using TInterleaverW = TInterleaverT<wchar_t>;
+
+// ---- Transcode farm ----------------------------------------------------------
+
+/// Outcome of a @c TTranscodeFarmT job. Failures are reported by the job's future as an exception.
+struct TJobStatus {
+    enum Enum {
+        Completed = 0,  ///< @c run() finished.
+        Cancelled = 1   ///< @c cancel() was called before or during @c run().
+    };
+};
+
+namespace detail {
+
+/// Move-only type-erased @c void() task, so @c std::packaged_task and promises can be queued.
+class TFarmTask {
+    struct Base {
+        virtual ~Base() = default;
+        virtual void run() = 0;
+    };
+    template<typename F>
+    struct Impl final : Base {
+        F f;
+        explicit Impl(F&& fn) : f(std::move(fn)) {}
+        void run() override { f(); }
+    };
+
+    std::unique_ptr<Base> impl_;
+
+public:
+    TFarmTask() = default;
+
+    template<typename F>
+    explicit TFarmTask(F f) : impl_(std::make_unique<Impl<F>>(std::move(f))) {}
+
+    explicit operator bool() const { return impl_ != nullptr; }
+    void operator()() { impl_->run(); }
+};
+
+} // namespace detail
+
+/**
+ * Handle to a job submitted with @c TTranscodeFarmT::submit(). Move-only.
+ *
+ * @c get() waits and returns the job's @c TJobStatus, or rethrows the
+ * exception the job failed with (typically @c TAVBlocksException).
+ * @c cancel() skips a job that has not started and stops a running one at
+ * the next @c onContinue tick.
+ */
+class TTranscodeJob {
+    std::shared_ptr<std::atomic<bool>> cancel_;
+    std::future<TJobStatus::Enum>      future_;
+
+public:
+    TTranscodeJob() = default;
+    TTranscodeJob(std::shared_ptr<std::atomic<bool>> cancel, std::future<TJobStatus::Enum> future)
+        : cancel_(std::move(cancel)), future_(std::move(future)) {}
+
+    void cancel() { if (cancel_) cancel_->store(true, std::memory_order_relaxed); }
+    bool cancelRequested() const { return cancel_ && cancel_->load(std::memory_order_relaxed); }
+
+    bool valid() const { return future_.valid(); }
+    void wait() const { future_.wait(); }
+
+    template<typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+        return future_.wait_for(timeout);
+    }
+
+    TJobStatus::Enum get() { return future_.get(); }
+};
+
+/**
+ * Runs many independent transcoding jobs on a work-stealing thread pool.
+ *
+ * Each worker owns a deque: tasks submitted from a worker go to its own
+ * deque (LIFO for locality), tasks from other threads are spread
+ * round-robin, and an idle worker steals the oldest task from a busy peer.
+ *
+ * @c submit() takes a function that configures a fresh @c TTranscoderT
+ * (inputs, outputs, parameters). The worker then opens, runs and closes it.
+ * @c TTranscodeJob::cancel() is implemented with @c TTranscoderT::runUnless(),
+ * so handlers the configure function installs (@c onProgress, @c onStatus,
+ * @c onContinue, @c onInputChange, @c callbacks()) are kept and keep
+ * receiving every event. @c post() queues an
+ * arbitrary callable, e.g. a push/pull loop or a @c TPipeline run.
+ *
+ * The farm holds a @c TLibrary reference for its whole lifetime, so the SDK
+ * stays initialized until every worker has exited regardless of other
+ * @c TLibrary objects. The destructor finishes all queued jobs, then joins.
+ *
+ * @code
+ * TTranscodeFarm farm;
+ * std::vector<TTranscodeJob> jobs;
+ * for (auto& clip : clips)
+ *     jobs.push_back(farm.submit([&clip](TTranscoder& t) {
+ *         t.addInput(TMediaSocket().file(clip.input))
+ *          .addOutput(TMediaSocket(Preset::Audio::Generic::M4A::AAC_LC).file(clip.output));
+ *     }));
+ * for (auto& job : jobs) job.get();
+ * @endcode
+ */
+template<typename CharT = char>
+class TTranscodeFarmT {
+    struct Worker {
+        std::mutex                    mutex;
+        std::deque<detail::TFarmTask> tasks;
+    };
+
+    TLibrary                             library_;   // first: outlives the workers
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread>             threads_;
+
+    std::mutex              sleepMutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    size_t                  queued_   = 0;   // guarded by sleepMutex_
+    size_t                  inFlight_ = 0;   // guarded by sleepMutex_
+    bool                    stopping_ = false;
+    std::atomic<size_t>     next_{0};
+
+    // Worker index of the current thread within the farm that owns it.
+    inline static thread_local const TTranscodeFarmT* currentFarm_ = nullptr;
+    inline static thread_local size_t                 currentIndex_ = 0;
+
+    void enqueue(detail::TFarmTask task) {
+        size_t index = currentFarm_ == this
+            ? currentIndex_
+            : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+        {
+            // Count and publish under sleepMutex_: a worker may only take the task
+            // (and decrement) once the counters include it. Workers never hold a
+            // deque mutex while taking sleepMutex_, so the nesting cannot deadlock.
+            std::lock_guard<std::mutex> sleepLock(sleepMutex_);
+            ++queued_;
+            ++inFlight_;
+            std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+            workers_[index]->tasks.push_back(std::move(task));
+        }
+        wake_.notify_one();
+    }
+
+    bool popLocal(size_t index, detail::TFarmTask& task) {
+        Worker& worker = *workers_[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty())
+            return false;
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t index, detail::TFarmTask& task) {
+        for (size_t i = 1; i < workers_.size(); ++i) {
+            Worker& victim = *workers_[(index + i) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index) {
+        currentFarm_  = this;
+        currentIndex_ = index;
+
+        for (;;) {
+            detail::TFarmTask task;
+            if (popLocal(index, task) || steal(index, task)) {
+                {
+                    std::lock_guard<std::mutex> lock(sleepMutex_);
+                    --queued_;
+                }
+                task();
+                bool drained;
+                {
+                    std::lock_guard<std::mutex> lock(sleepMutex_);
+                    drained = --inFlight_ == 0;
+                }
+                if (drained)
+                    idle_.notify_all();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            wake_.wait(lock, [this] { return queued_ > 0 || stopping_; });
+            if (stopping_ && queued_ == 0)
+                return;
+        }
+    }
+
+public:
+    /// Starts @p threadCount workers (at least one; defaults to the number of hardware threads).
+    explicit TTranscodeFarmT(size_t threadCount = std::thread::hardware_concurrency()) {
+        if (threadCount == 0)
+            threadCount = 1;
+        workers_.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; ++i)
+            workers_.push_back(std::make_unique<Worker>());
+        threads_.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; ++i)
+            threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    /// Runs every queued job to completion, then joins the workers.
+    ~TTranscodeFarmT() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_)
+            thread.join();
+    }
+
+    TTranscodeFarmT(const TTranscodeFarmT&) = delete;
+    TTranscodeFarmT& operator=(const TTranscodeFarmT&) = delete;
+
+    /**
+     * Queues a transcoding job. @p configure receives a new transcoder on a
+     * worker thread and adds its sockets; the worker then calls @c open(),
+     * @c run() and @c close(). Errors from any step surface through
+     * @c TTranscodeJob::get().
+     */
+    template<typename Configure>
+    TTranscodeJob submit(Configure configure) {
+        auto cancel  = std::make_shared<std::atomic<bool>>(false);
+        auto promise = std::make_shared<std::promise<TJobStatus::Enum>>();
+        TTranscodeJob job(cancel, promise->get_future());
+
+        enqueue(detail::TFarmTask([cancel, promise, configure = std::move(configure)]() mutable {
+            try {
+                if (cancel->load(std::memory_order_relaxed)) {
+                    promise->set_value(TJobStatus::Cancelled);
+                    return;
+                }
+                TTranscoderT<CharT> transcoder;
+                configure(transcoder);
+                transcoder.open();
+                const TRunResult result = transcoder.runUnless([&cancel] {
+                    return cancel->load(std::memory_order_relaxed);
+                });
+                TErrorInfo error = result.status == TRunStatus::Failed ? transcoder.error() : TErrorInfo();
+                transcoder.close();
+                if (result.status == TRunStatus::Failed)
+                    throw TAVBlocksException("Failed to run transcoder", error);
+                promise->set_value(result.completed() ? TJobStatus::Completed : TJobStatus::Cancelled);
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        }));
+        return job;
+    }
+
+    /// Queues an arbitrary callable and returns a future for its result.
+    template<typename F>
+    auto post(F f) -> std::future<std::invoke_result_t<F>> {
+        std::packaged_task<std::invoke_result_t<F>()> task(std::move(f));
+        auto future = task.get_future();
+        enqueue(detail::TFarmTask(std::move(task)));
+        return future;
+    }
+
+    /// Blocks until every job submitted so far has finished.
+    void wait() {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        idle_.wait(lock, [this] { return inFlight_ == 0; });
+    }
+
+    size_t threadCount() const { return threads_.size(); }
+
+    /// Jobs queued or running.
+    size_t pending() {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        return inFlight_;
+    }
+};
+
+using TTranscodeFarm  = TTranscodeFarmT<char>;
+using TTranscodeFarmW = TTranscodeFarmT<wchar_t>;
+
+// ---- Segment-parallel encoding -----------------------------------------------
+
+/// A time range of the input in seconds. The last segment of a plan ends at infinity.
+struct TSegment {
+    double start = 0;
+    double end   = std::numeric_limits<double>::infinity();
+};
+
+/**
+ * Encodes one long input as N time segments in parallel and joins the results.
+ *
+ * @c plan() probes the input with @c TMediaInfoT, picks its first video
+ * stream (or its first audio stream if there is no video), and splits the
+ * duration into equal, frame-aligned ranges. @c run() encodes every range on
+ * a @c TTranscodeFarmT and then concatenates the segment files.
+ *
+ * Each segment is a decoder whose input socket starts at
+ * @c TMediaSocketT::timePosition(start), feeding a separate encoder. Decoded
+ * samples outside [start, end) are dropped, so the cuts are frame-exact
+ * even when the SDK seeks to an earlier key frame. Every segment has its own
+ * encoder, so every segment starts a closed GOP with an IDR frame.
+ *
+ * The segments are joined by byte concatenation, with no re-encode and no
+ * remux. The output must therefore be a self-delimiting elementary stream:
+ * H.264 or H.265 Annex B, AAC ADTS or MPEG audio. Mux the joined stream
+ * afterwards if a container is needed. Audio cuts fall on decoded-block
+ * boundaries and each segment carries its own encoder priming, so audio is
+ * usually best encoded in a single pass next to the segmented video.
+ *
+ * @code
+ * TSegmentEncoder encoder("movie.mp4", [] {
+ *     return TMediaSocket()
+ *         .streamType(StreamType::H264)
+ *         .streamSubType(StreamSubType::AVC_Annex_B)
+ *         .addPin(TMediaPin().streamInfo(TVideoStreamInfo()
+ *             .streamType(StreamType::H264)
+ *             .streamSubType(StreamSubType::AVC_Annex_B)));
+ * });
+ * encoder.segments(16).run("movie.h264");
+ * @endcode
+ */
+template<typename CharT = char>
+class TSegmentEncoderT {
+public:
+    using Socket        = TMediaSocketT<CharT>;
+    using string_type   = typename Socket::string_type;
+    using OutputFactory = std::function<Socket()>;
+
+    /// @p makeOutput returns a configured output socket without a file. @c run() calls it
+    /// once per segment on the calling thread, before the segments are dispatched.
+    TSegmentEncoderT(string_type inputFile, OutputFactory makeOutput)
+        : input_(std::move(inputFile)), makeOutput_(std::move(makeOutput)) {}
+
+    /// Number of segments (fluent). 0, the default, uses one per hardware thread.
+    TSegmentEncoderT& segments(int32_t count) {
+        segments_ = count;
+        return *this;
+    }
+
+    /// Shortest segment worth splitting off, in seconds (fluent). Default 10.
+    TSegmentEncoderT& minSegmentDuration(double seconds) {
+        minDuration_ = seconds;
+        return *this;
+    }
+
+    TSegmentEncoderT& allowDemoMode(bool allow = true) {
+        demoMode_ = allow;
+        return *this;
+    }
+
+    /// Probes the input (once) and returns the segment ranges @c run() will encode.
+    std::vector<TSegment> plan() {
+        probe();
+
+        int32_t count = segments_ > 0 ? segments_ : static_cast<int32_t>(std::thread::hardware_concurrency());
+        if (duration_ <= 0) {
+            count = 1;
+        } else if (minDuration_ > 0) {
+            count = std::min(count, static_cast<int32_t>(duration_ / minDuration_));
+        }
+        count = std::max(count, 1);
+
+        std::vector<TSegment> ranges(static_cast<size_t>(count));
+        for (int32_t k = 1; k < count; ++k) {
+            double cut = duration_ * k / count;
+            if (frameRate_ > 0)
+                cut = std::round(cut * frameRate_) / frameRate_;
+            ranges[k - 1].end = cut;
+            ranges[k].start   = cut;
+        }
+        return ranges;
+    }
+
+    /// Encodes all segments in parallel and writes the joined stream to @p outputFile.
+    /// Throws @c TAVBlocksException (or @c std::invalid_argument for an unsupported
+    /// output type) with the first segment failure; segment files are removed either way.
+    void run(const string_type& outputFile) {
+        checkConcatenable(makeOutput_());
+        std::vector<TSegment> ranges = plan();
+
+        std::vector<std::filesystem::path> parts;
+        std::vector<Socket> outputs;
+        for (size_t k = 0; k < ranges.size(); ++k) {
+            std::filesystem::path part(outputFile);
+            part += ".part" + std::to_string(k);
+            parts.push_back(part);
+            outputs.push_back(makeOutput_());
+        }
+
+        std::exception_ptr failure;
+        {
+            TTranscodeFarmT<CharT> farm(ranges.size());
+            std::vector<std::future<void>> done;
+            for (size_t k = 0; k < ranges.size(); ++k) {
+                done.push_back(farm.post([this, range = ranges[k], part = parts[k],
+                                          output = std::move(outputs[k])]() mutable {
+                    encodeSegment(range, part, std::move(output));
+                }));
+            }
+            for (auto& f : done) {
+                try {
+                    f.get();
+                } catch (...) {
+                    if (!failure)
+                        failure = std::current_exception();
+                }
+            }
+        }
+
+        if (!failure) {
+            std::ofstream out(std::filesystem::path(outputFile), std::ios::binary | std::ios::trunc);
+            for (const auto& part : parts) {
+                std::ifstream in(part, std::ios::binary);
+                if (in.peek() != std::ifstream::traits_type::eof())
+                    out << in.rdbuf();
+            }
+            if (!out)
+                failure = std::make_exception_ptr(std::runtime_error("Failed to write the joined segments"));
+        }
+
+        std::error_code ignored;
+        for (const auto& part : parts)
+            std::filesystem::remove(part, ignored);
+
+        if (failure)
+            std::rethrow_exception(failure);
+    }
+
+private:
+    string_type   input_;
+    OutputFactory makeOutput_;
+    int32_t       segments_    = 0;
+    double        minDuration_ = 10;
+    bool          demoMode_    = false;
+
+    // Probe results
+    bool                            probed_    = false;
+    primo::codecs::MediaType::Enum  mediaType_ = primo::codecs::MediaType::Unknown;
+    double                          duration_  = 0;
+    double                          frameRate_ = 0;
+    int32_t                         width_     = 0;
+    int32_t                         height_    = 0;
+    int32_t                         channels_  = 0;
+    int32_t                         sampleRate_ = 0;
+
+    static void checkConcatenable(const Socket& socket) {
+        using primo::codecs::StreamType;
+        using primo::codecs::StreamSubType;
+        // Length-prefixed AVCC/HVCC samples cannot be byte-concatenated; an unset
+        // subtype means the SDK's default for an elementary stream, Annex B.
+        const StreamSubType::Enum subType = socket.streamSubType();
+        const bool unsetSubType = subType == StreamSubType::None || subType == StreamSubType::Unknown;
+        switch (socket.streamType()) {
+            case StreamType::H264:
+                if (unsetSubType || subType == StreamSubType::AVC_Annex_B)
+                    return;
+                break;
+            case StreamType::H265:
+                if (unsetSubType || subType == StreamSubType::HEVC_Annex_B)
+                    return;
+                break;
+            case StreamType::MPEG_Audio:
+                return;
+            case StreamType::AAC:
+                if (socket.streamSubType() == StreamSubType::AAC_ADTS)
+                    return;
+                break;
+            default:
+                break;
+        }
+        throw std::invalid_argument(
+            "TSegmentEncoder: output must be an H.264/H.265 Annex B, AAC ADTS or MPEG audio elementary stream");
+    }
+
+    void probe() {
+        if (probed_)
+            return;
+
+        TMediaInfoT<CharT> info;
+        info.inputs(0).file(input_);
+        info.open();
+
+        for (int32_t s = 0; s < info.outputs().count() && mediaType_ != primo::codecs::MediaType::Video; ++s) {
+            TMediaPinList pins = info.outputs(s).pins();
+            for (int32_t i = 0; i < pins.count(); ++i) {
+                TMediaPin pin = pins.at(i);
+                primo::codecs::MediaType::Enum type = pin.streamInfo().mediaType();
+                if (type == primo::codecs::MediaType::Video) {
+                    TVideoStreamInfoView video = pin.videoStreamInfoView();
+                    mediaType_ = type;
+                    duration_  = video.duration();
+                    frameRate_ = video.frameRate();
+                    width_     = video.frameWidth();
+                    height_    = video.frameHeight();
+                    break;
+                }
+                if (type == primo::codecs::MediaType::Audio && mediaType_ == primo::codecs::MediaType::Unknown) {
+                    TAudioStreamInfoView audio = pin.audioStreamInfoView();
+                    mediaType_  = type;
+                    duration_   = audio.duration();
+                    channels_   = audio.channels();
+                    sampleRate_ = audio.sampleRate();
+                }
+            }
+        }
+
+        if (mediaType_ == primo::codecs::MediaType::Unknown)
+            throw std::invalid_argument("TSegmentEncoder: input has no audio or video stream");
+        probed_ = true;
+    }
+
+    /// Socket describing the decoded stream handed from segment decoder to segment encoder.
+    Socket rawSocket() const {
+        using primo::codecs::StreamType;
+        if (mediaType_ == primo::codecs::MediaType::Video) {
+            return Socket()
+                .streamType(StreamType::UncompressedVideo)
+                .addPin(TMediaPin().streamInfo(TVideoStreamInfo()
+                    .streamType(StreamType::UncompressedVideo)
+                    .colorFormat(primo::codecs::ColorFormat::YUV420)
+                    .frameWidth(width_)
+                    .frameHeight(height_)
+                    .frameRate(frameRate_)));
+        }
+        return Socket()
+            .streamType(StreamType::LPCM)
+            .addPin(TMediaPin().streamInfo(TAudioStreamInfo()
+                .streamType(StreamType::LPCM)
+                .channels(channels_)
+                .sampleRate(sampleRate_)
+                .bitsPerSample(16)));
+    }
+
+    void encodeSegment(const TSegment& range, const std::filesystem::path& part, Socket output) const {
+        string_type partName;
+        if constexpr (std::is_same_v<CharT, wchar_t>)
+            partName = part.wstring();
+        else
+            partName = part.string();
+
+        TTranscoderT<CharT> decoder;
+        decoder.allowDemoMode(demoMode_)
+            .addInput(Socket().file(input_).timePosition(range.start))
+            .addOutput(rawSocket())
+            .open();
+
+        TTranscoderT<CharT> encoder;
+        encoder.allowDemoMode(demoMode_)
+            .addInput(rawSocket())
+            .addOutput(output.file(partName))
+            .open();
+
+        // Half a frame of slack so rounding in timestamps does not move a frame across a cut.
+        const double slack = frameRate_ > 0 ? 0.5 / frameRate_ : 0.0;
+
+        TMediaSample sample;
+        int32_t index = 0;
+        bool reachedEnd = false;
+        while (decoder.pull(index, sample)) {
+            double time = sample.startTime();
+            if (time >= 0 && time < range.start - slack)
+                continue;
+            if (time >= 0 && time >= range.end - slack) {
+                reachedEnd = true;
+                break;
+            }
+            if (!encoder.push(0, sample))
+                throw TAVBlocksException("Failed to encode segment", encoder.error());
+        }
+        if (!reachedEnd && !decoder.isEos())
+            throw TAVBlocksException("Failed to decode segment", decoder.error());
+        if (!encoder.pushEos(0))
+            throw TAVBlocksException("Failed to finish segment", encoder.error());
+
+        decoder.close();
+        encoder.close();
+    }
+};
+
+using TSegmentEncoder  = TSegmentEncoderT<char>;
+using TSegmentEncoderW = TSegmentEncoderT<wchar_t>;
+
+// ---- ABR ladder --------------------------------------------------------------
+
+/**
+ * Builds a bitrate ladder from one input with a single decode.
+ *
+ * One decoder turns the input's first video stream (and its first audio
+ * stream, if @c audio() is set) into raw frames. Each rendition added with
+ * @c addRendition() gets its own encoder transcoder on its own thread; the
+ * encoder scales to the frame size in the rendition's output pin. Audio is
+ * encoded once, by a single encoder, for all renditions.
+ *
+ * Each decoded frame is copied once into a pooled buffer. Every video
+ * encoder then receives its own @c MediaBuffer that is zero-copy attached to
+ * those same bytes, so frames are shared by reference and no encoder can
+ * move another's data offset. Those per-encoder buffers are recycled from a
+ * small per-rendition list once the encoder releases them, which keeps the
+ * per-frame path off the process-wide attachment registry. Encoders are
+ * fed through bounded SPSC rings, so the slowest rendition applies
+ * backpressure to the decoder. The first failure cancels every thread and
+ * @c run() rethrows it.
+ *
+ * @code
+ * TAbrLadder ladder("source.mp4");
+ * for (auto [w, h, kbps] : { std::tuple{1920, 1080, 6000}, {1280, 720, 3000}, {640, 360, 800} })
+ *     ladder.addRendition(TMediaSocket()
+ *         .file(std::format("video_{}p.h264", h))
+ *         .streamType(StreamType::H264)
+ *         .streamSubType(StreamSubType::AVC_Annex_B)
+ *         .addPin(TMediaPin().streamInfo(TVideoStreamInfo()
+ *             .streamType(StreamType::H264)
+ *             .streamSubType(StreamSubType::AVC_Annex_B)
+ *             .frameWidth(w).frameHeight(h).bitrate(kbps * 1000))));
+ * ladder.audio(TMediaSocket(Preset::Audio::AudioCD::WAV).file("audio.wav"));   // any audio output
+ * ladder.run();
+ * @endcode
+ */
+template<typename CharT = char>
+class TAbrLadderT {
+public:
+    using Socket      = TMediaSocketT<CharT>;
+    using string_type = typename Socket::string_type;
+
+    explicit TAbrLadderT(string_type inputFile, size_t depth = 8)
+        : input_(std::move(inputFile)), depth_(depth ? depth : 1) {}
+
+    TAbrLadderT(const TAbrLadderT&) = delete;
+    TAbrLadderT& operator=(const TAbrLadderT&) = delete;
+
+    /// Adds a video rendition (fluent). @p output is a complete output socket, including its file or stream.
+    TAbrLadderT& addRendition(Socket&& output) {
+        renditions_.push_back(std::move(output));
+        return *this;
+    }
+
+    /// Sets the single audio output shared by all renditions (fluent). Without it, audio is ignored.
+    TAbrLadderT& audio(Socket&& output) {
+        audio_ = std::move(output);
+        return *this;
+    }
+
+    TAbrLadderT& allowDemoMode(bool allow = true) {
+        demoMode_ = allow;
+        return *this;
+    }
+
+    size_t renditionCount() const { return renditions_.size(); }
+
+    /// Decodes once and encodes every rendition and the audio output. Throws on the first failure.
+    void run() {
+        if (renditions_.empty())
+            throw std::invalid_argument("TAbrLadder: no renditions");
+
+        probe();
+
+        TTranscoderT<CharT> decoder;
+        decoder.allowDemoMode(demoMode_).addInput(Socket().file(input_));
+        decoder.addOutput(rawVideoSocket());
+        const bool withAudio = audio_.has_value() && hasAudio_;
+        if (withAudio)
+            decoder.addOutput(rawAudioSocket());
+        decoder.open();
+
+        // Encoder 0..N-1: video renditions; encoder N: audio (optional).
+        std::vector<std::unique_ptr<TTranscoderT<CharT>>> encoders;
+        for (auto& rendition : renditions_) {
+            auto encoder = std::make_unique<TTranscoderT<CharT>>();
+            encoder->allowDemoMode(demoMode_).addInput(rawVideoSocket()).addOutput(rendition).open();
+            encoders.push_back(std::move(encoder));
+        }
+        if (withAudio) {
+            auto encoder = std::make_unique<TTranscoderT<CharT>>();
+            encoder->allowDemoMode(demoMode_).addInput(rawAudioSocket()).addOutput(*audio_).open();
+            encoders.push_back(std::move(encoder));
+        }
+
+        rings_.clear();
+        for (size_t i = 0; i < encoders.size(); ++i)
+            rings_.push_back(std::make_unique<Ring>(depth_));
+        views_.assign(encoders.size(), {});
+        failed_.store(false);
+        failure_ = nullptr;
+
+        std::vector<std::thread> workers;
+        workers.reserve(encoders.size());
+        try {
+            for (size_t i = 0; i < encoders.size(); ++i)
+                workers.emplace_back([this, i, &encoders] { encode(*encoders[i], *rings_[i]); });
+            decode(decoder, withAudio);
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        for (auto& worker : workers)
+            worker.join();
+
+        decoder.close();
+        for (auto& encoder : encoders)
+            encoder->close();
+        rings_.clear();
+        views_.clear();
+
+        if (failure_)
+            std::rethrow_exception(failure_);
+    }
+
+private:
+    struct Slot {
+        TMediaSample sample;
+        bool         eos = false;
+    };
+    using Ring = detail::TSpscRing<Slot>;
+
+    /// A per-encoder buffer attached to the shared bytes of one decoded frame.
+    struct View {
+        primo::ref<primo::codecs::MediaBuffer> buffer;
+        std::shared_ptr<TMediaBuffer>          bytes;
+    };
+
+    string_type           input_;
+    size_t                depth_;
+    std::vector<Socket>   renditions_;
+    std::optional<Socket> audio_;
+    bool                  demoMode_ = false;
+
+    bool    hasAudio_  = false;
+    int32_t width_     = 0;
+    int32_t height_    = 0;
+    double  frameRate_ = 0;
+    int32_t channels_  = 0;
+    int32_t sampleRate_ = 0;
+
+    TMediaBufferPool                   pool_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+    std::vector<std::vector<View>>     views_;   // per ring; touched only by the decode thread
+    std::mutex                         failureMutex_;
+    std::atomic<bool>                  failed_{false};
+    std::exception_ptr                 failure_;
+
+    void fail(std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> lock(failureMutex_);
+            if (failed_.load(std::memory_order_relaxed))
+                return;
+            failure_ = std::move(error);
+            failed_.store(true, std::memory_order_release);
+        }
+        for (auto& ring : rings_)
+            ring->cancel();
+    }
+
+    void probe() {
+        TMediaInfoT<CharT> info;
+        info.inputs(0).file(input_);
+        info.open();
+
+        bool hasVideo = false;
+        for (int32_t s = 0; s < info.outputs().count(); ++s) {
+            TMediaPinList pins = info.outputs(s).pins();
+            for (int32_t i = 0; i < pins.count(); ++i) {
+                TMediaPin pin = pins.at(i);
+                primo::codecs::MediaType::Enum type = pin.streamInfo().mediaType();
+                if (type == primo::codecs::MediaType::Video && !hasVideo) {
+                    TVideoStreamInfoView video = pin.videoStreamInfoView();
+                    width_     = video.frameWidth();
+                    height_    = video.frameHeight();
+                    frameRate_ = video.frameRate();
+                    hasVideo   = true;
+                } else if (type == primo::codecs::MediaType::Audio && !hasAudio_) {
+                    TAudioStreamInfoView audio = pin.audioStreamInfoView();
+                    channels_   = audio.channels();
+                    sampleRate_ = audio.sampleRate();
+                    hasAudio_   = true;
+                }
+            }
+        }
+        if (!hasVideo)
+            throw std::invalid_argument("TAbrLadder: input has no video stream");
+    }
+
+    Socket rawVideoSocket() const {
+        using primo::codecs::StreamType;
+        return Socket()
+            .streamType(StreamType::UncompressedVideo)
+            .addPin(TMediaPin().streamInfo(TVideoStreamInfo()
+                .streamType(StreamType::UncompressedVideo)
+                .colorFormat(primo::codecs::ColorFormat::YUV420)
+                .frameWidth(width_)
+                .frameHeight(height_)
+                .frameRate(frameRate_)));
+    }
+
+    Socket rawAudioSocket() const {
+        using primo::codecs::StreamType;
+        return Socket()
+            .streamType(StreamType::LPCM)
+            .addPin(TMediaPin().streamInfo(TAudioStreamInfo()
+                .streamType(StreamType::LPCM)
+                .channels(channels_)
+                .sampleRate(sampleRate_)
+                .bitsPerSample(16)));
+    }
+
+    /// Returns a buffer of ring @p ringIndex's view list that its encoder no longer holds,
+    /// attached to @p bytes.
+    primo::codecs::MediaBuffer* attachView(size_t ringIndex, const std::shared_ptr<TMediaBuffer>& bytes) {
+        std::vector<View>& views = views_[ringIndex];
+        View* view = nullptr;
+        for (auto& candidate : views) {
+            if (candidate.buffer->retainCount() == 1) {
+                view = &candidate;
+                break;
+            }
+        }
+        if (!view) {
+            view = &views.emplace_back();
+            view->buffer = primo::ref<primo::codecs::MediaBuffer>(primo::avblocks::Library::createMediaBuffer());
+        }
+        view->bytes = bytes;   // keeps the frame alive while the encoder holds the view
+        view->buffer->attach(const_cast<uint8_t*>(bytes->data()), bytes->dataSize(), FALSE);
+        return view->buffer.get();
+    }
+
+    /// Publishes one sample to ring @p ringIndex whose buffer views @p bytes. Returns @c false if cancelled.
+    bool publish(size_t ringIndex, const TMediaSample& from, const std::shared_ptr<TMediaBuffer>& bytes) {
+        Ring& ring = *rings_[ringIndex];
+        if (!ring.waitForSpace())
+            return false;
+        Slot& slot = ring.back();
+        if (bytes)
+            slot.sample.buffer(TMediaBuffer(attachView(ringIndex, bytes)));
+        else
+            slot.sample.buffer(nullptr);
+        detail::copySampleTiming(from, slot.sample);
+        slot.eos = false;
+        ring.push();
+        return true;
+    }
+
+    bool publishEos(Ring& ring) {
+        if (!ring.waitForSpace())
+            return false;
+        Slot& slot = ring.back();
+        slot.sample.buffer(nullptr);
+        slot.eos = true;
+        ring.push();
+        return true;
+    }
+
+    void decode(TTranscoderT<CharT>& decoder, bool withAudio) {
+        const size_t videoCount = renditions_.size();
+        TMediaSample sample;
+        TMediaSample decoded;
+        int32_t index = 0;
+
+        while (decoder.pull(index, sample)) {
+            // One copy per decoded sample, shared by every rendition.
+            detail::copySample(pool_, sample, decoded);
+            std::shared_ptr<TMediaBuffer> bytes;
+            if (decoded.bufferView().valid())
+                bytes = std::make_shared<TMediaBuffer>(decoded.buffer());
+
+            if (index == 0) {
+                for (size_t i = 0; i < videoCount; ++i) {
+                    if (!publish(i, sample, bytes))
+                        return;
+                }
+            } else if (withAudio && index == 1) {
+                if (!publish(videoCount, sample, bytes))
+                    return;
+            }
+        }
+
+        if (!decoder.isEos()) {
+            fail(std::make_exception_ptr(TAVBlocksException("Failed to decode ladder input", decoder.error())));
+            return;
+        }
+        for (auto& ring : rings_) {
+            if (!publishEos(*ring))
+                return;
+        }
+    }
+
+    void encode(TTranscoderT<CharT>& encoder, Ring& ring) {
+        try {
+            for (;;) {
+                if (!ring.waitForData())
+                    return;
+                Slot& slot = ring.front();
+                if (slot.eos) {
+                    ring.pop();
+                    break;
+                }
+                bool pushed = encoder.push(0, slot.sample);
+                slot.sample.buffer(nullptr);
+                ring.pop();
+                if (!pushed)
+                    throw TAVBlocksException("Failed to encode ladder rendition", encoder.error());
+            }
+            if (!encoder.pushEos(0))
+                throw TAVBlocksException("Failed to finish ladder rendition", encoder.error());
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    }
+};
+
+using TAbrLadder  = TAbrLadderT<char>;
+using TAbrLadderW = TAbrLadderT<wchar_t>;
+
 } // namespace primo::avblocks::modern
\ No newline at end of file
@@ -0,0 +1,3098 @@
+#pragma once
+
+#include <primo/avblocks/avb++.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <system_error>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <netinet/in.h>
+    #include <sys/mman.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/time.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #if defined(__linux__)
+        #include <sys/eventfd.h>
+        #include <sys/syscall.h>
+        #include <sys/uio.h>
+        #if __has_include(<linux/io_uring.h>)
+            #include <linux/io_uring.h>
+            #define PRIMO_AVBLOCKS_HAVE_IO_URING 1
+        #endif
+    #endif
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define PRIMO_AVBLOCKS_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define PRIMO_AVBLOCKS_TARGET(features)
+    #else
+        #include <cpuid.h>
+        #define PRIMO_AVBLOCKS_TARGET(features) __attribute__((target(features)))
+    #endif
+#endif
+
+// Platform memory and I/O helpers for the modern AVBlocks API.
+//
+// Kept apart from avb++.h because everything here talks to the operating
+// system or the CPU directly (file mappings, descriptors, events, SIMD
+// checksums) and pulls in the corresponding platform headers.
+
+namespace primo::avblocks::modern {
+
+namespace detail {
+
+#if defined(_WIN32)
+inline int32_t lastSystemError() { return static_cast<int32_t>(::GetLastError()); }
+constexpr int32_t systemFacility = primo::error::ErrorFacility::SystemWindows;
+#else
+inline int32_t lastSystemError() { return errno; }
+constexpr int32_t systemFacility = primo::error::ErrorFacility::SystemUnix;
+#endif
+
+/// Captures the calling thread's last OS error as a @c TErrorInfo.
+inline TErrorInfo systemError(const char* hint = nullptr) {
+    const int32_t code = lastSystemError();
+    return TErrorInfo(systemFacility, code,
+                      std::system_category().message(code),
+                      hint ? std::string(hint) : std::string{});
+}
+
+} // namespace detail
+
+/// Access-pattern hints for @c TMappedFile. Values may be combined.
+struct MapAdvice {
+    enum Enum {
+        Normal     = 0,
+        /// Read mostly front to back; the kernel reads ahead aggressively.
+        Sequential = 1,
+        /// Start paging the whole file in right after mapping.
+        WillNeed   = 2,
+        /// Ask for transparent huge pages where the platform and file system allow it.
+        HugePages  = 4,
+    };
+};
+
+/**
+ * Copy-on-write memory mapping of a whole file.
+ *
+ * Slices of the mapping are handed out as @c TMediaBuffer / @c TMediaSample
+ * objects through the zero-copy @c TMediaBuffer::attach() overload, so pushing
+ * a file (or an access unit / image inside it) into a transcoder involves no
+ * read() and no memcpy. Every buffer handed out keeps the mapping alive, so
+ * the @c TMappedFile itself may be closed or destroyed while the SDK still
+ * holds samples that point into it.
+ *
+ * The file is opened read-only but mapped copy-on-write, because
+ * @c TMediaBuffer::start() is mutable: an in-place write by the caller or the
+ * SDK lands in a private copy of the page and never reaches the file.
+ * Buffers are limited to 2 GiB by the SDK's @c int32_t sizes; map larger
+ * files in slices.
+ *
+ * @c open() throws @c TAVBlocksException (with an @c ErrorFacility::SystemUnix
+ * or @c SystemWindows error) on failure; @c tryOpen() returns @c false instead.
+ * An empty file maps successfully with @c size() == 0.
+ */
+class TMappedFile {
+    struct Mapping {
+        const uint8_t* data{};
+        size_t         size{};
+#if defined(_WIN32)
+        HANDLE         file{INVALID_HANDLE_VALUE};
+        HANDLE         section{};
+#endif
+
+        Mapping() = default;
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        ~Mapping() {
+#if defined(_WIN32)
+            if (data)    ::UnmapViewOfFile(data);
+            if (section) ::CloseHandle(section);
+            if (file != INVALID_HANDLE_VALUE) ::CloseHandle(file);
+#else
+            if (data) ::munmap(const_cast<uint8_t*>(data), size);
+#endif
+        }
+    };
+
+    std::shared_ptr<const Mapping> mapping_;
+    TErrorInfo                     error_;
+
+    static std::shared_ptr<Mapping> map(const std::filesystem::path& path, int32_t advice, TErrorInfo& error) {
+        auto m = std::make_shared<Mapping>();
+        auto fail = [&error] { error = detail::systemError(); return nullptr; };
+
+#if defined(_WIN32)
+        m->file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                (advice & MapAdvice::Sequential) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+        if (m->file == INVALID_HANDLE_VALUE)
+            return fail();
+
+        LARGE_INTEGER size{};
+        if (!::GetFileSizeEx(m->file, &size))
+            return fail();
+
+        m->size = static_cast<size_t>(size.QuadPart);
+        if (m->size == 0)
+            return m;
+
+        m->section = ::CreateFileMappingW(m->file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (!m->section)
+            return fail();
+
+        m->data = static_cast<const uint8_t*>(::MapViewOfFile(m->section, FILE_MAP_COPY, 0, 0, 0));
+        if (!m->data)
+            return fail();
+
+    #if _WIN32_WINNT >= 0x0602
+        if (advice & MapAdvice::WillNeed) {
+            WIN32_MEMORY_RANGE_ENTRY range{ const_cast<uint8_t*>(m->data), m->size };
+            ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+        }
+    #endif
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return fail();
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            fail();
+            ::close(fd);
+            return nullptr;
+        }
+
+        m->size = static_cast<size_t>(st.st_size);
+        if (m->size == 0) {
+            ::close(fd);
+            return m;
+        }
+
+        void* p = ::mmap(nullptr, m->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            fail();
+            ::close(fd);
+            return nullptr;
+        }
+        ::close(fd);   // the mapping keeps its own reference to the file
+        m->data = static_cast<const uint8_t*>(p);
+
+        // Advice is best effort; failures (e.g. no THP support) are ignored.
+        if (advice & MapAdvice::Sequential)
+            ::posix_madvise(p, m->size, POSIX_MADV_SEQUENTIAL);
+        if (advice & MapAdvice::WillNeed)
+            ::posix_madvise(p, m->size, POSIX_MADV_WILLNEED);
+    #if defined(MADV_HUGEPAGE)
+        if (advice & MapAdvice::HugePages)
+            ::madvise(p, m->size, MADV_HUGEPAGE);
+    #endif
+#endif
+        return m;
+    }
+
+public:
+    TMappedFile() = default;
+
+    /// Maps @p path, throwing @c TAVBlocksException on failure.
+    explicit TMappedFile(const std::filesystem::path& path,
+                         int32_t advice = MapAdvice::Sequential | MapAdvice::WillNeed) {
+        open(path, advice);
+    }
+
+    TMappedFile(const TMappedFile&) = delete;
+    TMappedFile& operator=(const TMappedFile&) = delete;
+    TMappedFile(TMappedFile&&) = default;
+    TMappedFile& operator=(TMappedFile&&) = default;
+
+    /// Maps @p path (replacing any current mapping), throwing @c TAVBlocksException on failure.
+    TMappedFile& open(const std::filesystem::path& path,
+                      int32_t advice = MapAdvice::Sequential | MapAdvice::WillNeed) {
+        if (!tryOpen(path, advice))
+            throw TAVBlocksException("Failed to map file", error_);
+        return *this;
+    }
+
+    /// Maps @p path (replacing any current mapping). Returns @c false on failure; see @c error().
+    bool tryOpen(const std::filesystem::path& path,
+                 int32_t advice = MapAdvice::Sequential | MapAdvice::WillNeed) {
+        mapping_.reset();
+        auto m = map(path, advice, error_);
+        if (!m)
+            return false;
+        error_   = TErrorInfo();
+        mapping_ = std::move(m);
+        return true;
+    }
+
+    /// Drops this object's reference to the mapping. Buffers handed out earlier stay valid.
+    void close() { mapping_.reset(); }
+
+    bool           isOpen() const { return mapping_ != nullptr; }
+    const uint8_t* data()   const { return mapping_ ? mapping_->data : nullptr; }
+    size_t         size()   const { return mapping_ ? mapping_->size : 0; }
+
+    /// Returns the bytes in [@p offset, @p offset + @p size), clamped to the file.
+    std::span<const std::byte> bytes(size_t offset = 0, size_t size = SIZE_MAX) const {
+        const size_t total = this->size();
+        if (offset > total)
+            offset = total;
+        if (size > total - offset)
+            size = total - offset;
+        return { reinterpret_cast<const std::byte*>(data()) + offset, size };
+    }
+
+    /// Returns a zero-copy @c TMediaBuffer over a slice of the mapping (the whole file by default).
+    /// The buffer keeps the mapping alive until the SDK releases it. Throws
+    /// @c std::length_error if the (clamped) slice is larger than 2 GiB.
+    TMediaBuffer buffer(size_t offset = 0, size_t size = SIZE_MAX) const {
+        auto slice = bytes(offset, size);
+        if (slice.size() > static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+            throw std::length_error("TMappedFile::buffer: slice exceeds 2 GiB; map the file in smaller slices");
+        TMediaBuffer buf;
+        buf.attach(reinterpret_cast<const uint8_t*>(slice.data()), slice.size(),
+                   std::shared_ptr<const void>(mapping_));
+        return buf;
+    }
+
+    /// Returns a @c TMediaSample carrying @c buffer(@p offset, @p size).
+    TMediaSample sample(size_t offset = 0, size_t size = SIZE_MAX) const {
+        TMediaSample s;
+        s.buffer(buffer(offset, size));
+        return s;
+    }
+
+    /// Hints that [@p offset, @p offset + @p size) will be read soon.
+    void willNeed(size_t offset, size_t size) const { advise(offset, size, true); }
+
+    /// Hints that [@p offset, @p offset + @p size) has been consumed and its pages may be reclaimed.
+    void dontNeed(size_t offset, size_t size) const { advise(offset, size, false); }
+
+    /// Returns the error of the last failed @c tryOpen().
+    const TErrorInfo& error() const { return error_; }
+
+private:
+    void advise(size_t offset, size_t size, bool willNeed) const {
+        auto slice = bytes(offset, size);
+        if (slice.empty())
+            return;
+
+#if defined(_WIN32)
+    #if _WIN32_WINNT >= 0x0602
+        if (willNeed) {
+            WIN32_MEMORY_RANGE_ENTRY range{ const_cast<std::byte*>(slice.data()), slice.size() };
+            ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+        }
+    #endif
+#else
+        // madvise ranges must start on a page boundary.
+        static const uintptr_t pageMask = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE)) - 1;
+        const auto begin = reinterpret_cast<uintptr_t>(slice.data()) & ~pageMask;
+        const auto end   = reinterpret_cast<uintptr_t>(slice.data()) + slice.size();
+        ::posix_madvise(reinterpret_cast<void*>(begin), end - begin,
+                        willNeed ? POSIX_MADV_WILLNEED : POSIX_MADV_DONTNEED);
+#endif
+    }
+};
+
+/// Options for @c TFrameArena. Values may be combined.
+struct ArenaFlags {
+    enum Enum {
+        None      = 0,
+        /// Back the arena with huge pages: explicit 2 MB pages (MAP_HUGETLB / MEM_LARGE_PAGES)
+        /// when the system has them reserved, transparent huge pages otherwise.
+        HugePages = 1,
+        /// Fault every page in up front so the first frames do not pay for page faults.
+        Prefault  = 2,
+    };
+};
+
+/**
+ * Pre-reserved arena of equally sized video frame buffers.
+ *
+ * Reserves @c slotCount() slots of @c videoBufferSizeInBytes(width, height,
+ * colorFormat) bytes each, 64-byte aligned, in one anonymous mapping. With
+ * @c ArenaFlags::HugePages the mapping uses explicit 2 MB huge pages when
+ * available and falls back to transparent huge pages (@c MADV_HUGEPAGE);
+ * with @c ArenaFlags::Prefault every page is touched up front. This keeps TLB
+ * misses and first-touch page faults out of 4K/8K uncompressed pipelines.
+ *
+ * @c acquire() hands out a slot as a zero-copy @c TMediaBuffer. The slot
+ * returns to the arena once the SDK has released the buffer, which is noticed
+ * on the next @c acquire() (see @c TMediaBuffer::collectAttached()). The
+ * memory stays mapped until the arena and every buffer it handed out are gone.
+ */
+class TFrameArena {
+    static constexpr size_t kAlignment    = 64;
+    static constexpr size_t kHugePageSize = size_t(2) << 20;
+
+    struct State {
+        uint8_t*             base{};
+        size_t               mappedBytes{};
+        bool                 hugePages{};
+        std::mutex           mutex;
+        std::vector<int32_t> freeSlots;
+
+        State() = default;
+        State(const State&) = delete;
+        State& operator=(const State&) = delete;
+
+        ~State() {
+            if (!base)
+                return;
+#if defined(_WIN32)
+            ::VirtualFree(base, 0, MEM_RELEASE);
+#else
+            ::munmap(base, mappedBytes);
+#endif
+        }
+    };
+
+    std::shared_ptr<State> state_;
+    size_t                 frameBytes_{};
+    size_t                 slotBytes_{};
+    int32_t                slotCount_{};
+
+    static size_t roundUp(size_t value, size_t multiple) {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    void reserve(int32_t flags) {
+        size_t bytes = slotBytes_ * static_cast<size_t>(slotCount_);
+        auto&  st    = *state_;
+
+#if defined(_WIN32)
+        if (flags & ArenaFlags::HugePages) {
+            const size_t large = ::GetLargePageMinimum();
+            if (large != 0) {
+                const size_t rounded = roundUp(bytes, large);
+                st.base = static_cast<uint8_t*>(::VirtualAlloc(nullptr, rounded,
+                    MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+                if (st.base) {
+                    st.mappedBytes = rounded;
+                    st.hugePages   = true;
+                }
+            }
+        }
+        if (!st.base) {
+            st.base = static_cast<uint8_t*>(::VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+            if (!st.base)
+                throw TAVBlocksException("Failed to reserve frame arena", detail::systemError());
+            st.mappedBytes = bytes;
+        }
+#else
+    #if defined(MAP_HUGETLB)
+        if (flags & ArenaFlags::HugePages) {
+            const size_t rounded = roundUp(bytes, kHugePageSize);
+            void* p = ::mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                st.base        = static_cast<uint8_t*>(p);
+                st.mappedBytes = rounded;
+                st.hugePages   = true;
+            }
+        }
+    #endif
+        if (!st.base) {
+            // Round to the huge page size anyway so transparent huge pages can cover the tail.
+            if (flags & ArenaFlags::HugePages)
+                bytes = roundUp(bytes, kHugePageSize);
+
+            void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                throw TAVBlocksException("Failed to reserve frame arena", detail::systemError());
+
+            st.base        = static_cast<uint8_t*>(p);
+            st.mappedBytes = bytes;
+
+    #if defined(MADV_HUGEPAGE)
+            // Advise before faulting pages in so they are allocated as huge pages.
+            if (flags & ArenaFlags::HugePages)
+                ::madvise(p, bytes, MADV_HUGEPAGE);
+    #endif
+        }
+#endif
+
+        if (flags & ArenaFlags::Prefault) {
+            const size_t step = st.hugePages ? kHugePageSize : 4096;
+            for (size_t offset = 0; offset < st.mappedBytes; offset += step)
+                st.base[offset] = 0;
+        }
+    }
+
+public:
+    /// Reserves @p slotCount slots sized for one @p width x @p height frame in @p colorFormat.
+    TFrameArena(int32_t width, int32_t height, primo::codecs::ColorFormat::Enum colorFormat,
+                int32_t slotCount, int32_t flags = ArenaFlags::HugePages | ArenaFlags::Prefault)
+        : TFrameArena(static_cast<size_t>(
+                          TMediaSample().videoBufferSizeInBytes(width, height, colorFormat)),
+                      slotCount, flags) {}
+
+    /// Reserves @p slotCount slots of @p frameBytes bytes each.
+    TFrameArena(size_t frameBytes, int32_t slotCount,
+                int32_t flags = ArenaFlags::HugePages | ArenaFlags::Prefault)
+        : state_(std::make_shared<State>())
+        , frameBytes_(frameBytes)
+        , slotBytes_(roundUp(frameBytes ? frameBytes : 1, kAlignment))
+        , slotCount_(slotCount) {
+        if (slotCount <= 0)
+            throw std::invalid_argument("Frame arena needs at least one slot");
+
+        reserve(flags);
+
+        state_->freeSlots.reserve(static_cast<size_t>(slotCount));
+        for (int32_t i = slotCount - 1; i >= 0; --i)
+            state_->freeSlots.push_back(i);
+    }
+
+    TFrameArena(const TFrameArena&) = delete;
+    TFrameArena& operator=(const TFrameArena&) = delete;
+    TFrameArena(TFrameArena&&) = default;
+    TFrameArena& operator=(TFrameArena&&) = default;
+
+    /// Returns a free slot as a buffer whose data range covers one whole frame,
+    /// or an empty optional when every slot is still referenced.
+    std::optional<TMediaBuffer> acquire() {
+        int32_t slot = takeSlot();
+        if (slot < 0) {
+            // Slots come back when the storage registry notices the SDK released their buffers.
+            TMediaBuffer::collectAttached();
+            slot = takeSlot();
+            if (slot < 0)
+                return std::nullopt;
+        }
+
+        uint8_t* data = state_->base + static_cast<size_t>(slot) * slotBytes_;
+        std::shared_ptr<const void> storage(data, [state = state_, slot](const void*) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->freeSlots.push_back(slot);
+        });
+
+        TMediaBuffer buffer;
+        buffer.attach(data, frameBytes_, std::move(storage));
+        return buffer;
+    }
+
+    /// Bytes in one frame, as passed in or computed by @c videoBufferSizeInBytes().
+    size_t  frameBytes() const { return frameBytes_; }
+    /// Distance between slots: @c frameBytes() rounded up to 64 bytes.
+    size_t  slotBytes()  const { return slotBytes_; }
+    int32_t slotCount()  const { return slotCount_; }
+
+    /// Number of slots currently free (without collecting released buffers first).
+    int32_t freeSlots() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return static_cast<int32_t>(state_->freeSlots.size());
+    }
+
+    /// Returns @c true if the arena got explicit huge pages rather than regular or transparent ones.
+    bool hugePages() const { return state_->hugePages; }
+
+private:
+    int32_t takeSlot() {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->freeSlots.empty())
+            return -1;
+        const int32_t slot = state_->freeSlots.back();
+        state_->freeSlots.pop_back();
+        return slot;
+    }
+};
+
+// ---- Event loop integration ------------------------------------------------
+
+namespace detail {
+
+/**
+ * Level-style readiness event for event loops: an eventfd on Linux, a
+ * non-blocking pipe on other POSIX systems and a manual-reset event on
+ * Windows. @c set() makes the handle readable (signalled) until @c reset().
+ */
+class TReadyEvent {
+#if defined(_WIN32)
+    HANDLE event_{};
+#else
+    int readFd_  = -1;
+    int writeFd_ = -1;
+#endif
+    bool set_ = false;
+
+public:
+#if defined(_WIN32)
+    using native_handle_type = HANDLE;
+#else
+    using native_handle_type = int;
+#endif
+
+    TReadyEvent() {
+#if defined(_WIN32)
+        event_ = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (!event_)
+            throw TAVBlocksException("Failed to create readiness event", systemError());
+#elif defined(__linux__)
+        readFd_ = writeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (readFd_ < 0)
+            throw TAVBlocksException("Failed to create readiness event", systemError("eventfd"));
+#else
+        int fds[2];
+        if (::pipe(fds) != 0)
+            throw TAVBlocksException("Failed to create readiness event", systemError("pipe"));
+        for (int fd : fds) {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        readFd_  = fds[0];
+        writeFd_ = fds[1];
+#endif
+    }
+
+    ~TReadyEvent() {
+#if defined(_WIN32)
+        ::CloseHandle(event_);
+#else
+        if (writeFd_ != readFd_)
+            ::close(writeFd_);
+        ::close(readFd_);
+#endif
+    }
+
+    TReadyEvent(const TReadyEvent&) = delete;
+    TReadyEvent& operator=(const TReadyEvent&) = delete;
+
+    native_handle_type handle() const {
+#if defined(_WIN32)
+        return event_;
+#else
+        return readFd_;
+#endif
+    }
+
+    void set() {
+        if (set_)
+            return;
+        set_ = true;
+#if defined(_WIN32)
+        ::SetEvent(event_);
+#elif defined(__linux__)
+        const uint64_t one = 1;
+        [[maybe_unused]] auto n = ::write(writeFd_, &one, sizeof(one));
+#else
+        const char one = 1;
+        [[maybe_unused]] auto n = ::write(writeFd_, &one, 1);
+#endif
+    }
+
+    void reset() {
+        if (!set_)
+            return;
+        set_ = false;
+#if defined(_WIN32)
+        ::ResetEvent(event_);
+#else
+        uint64_t drain;
+        while (::read(readFd_, &drain, sizeof(drain)) > 0) {}
+#endif
+    }
+};
+
+} // namespace detail
+
+/// Readiness flags reported by @c TPushSessionT. Values may be combined.
+struct Readiness {
+    enum Enum {
+        None     = 0,
+        /// @c pull() will return a sample, or the session has reached EOS or failed.
+        Readable = 1,
+        /// @c push() will be accepted.
+        Writable = 2,
+    };
+};
+
+/**
+ * Non-blocking push/pull front end for a push-mode transcoder, for use from
+ * an event loop (epoll, kqueue, io_uring, IOCP).
+ *
+ * The SDK only tells whether output is available by attempting @c pull(),
+ * so a loop would have to poll every session. The session instead drains the
+ * transcoder right after each @c push() and keeps the output in a small
+ * queue (copied into pooled buffers by @c detail::copySample()). That
+ * makes readiness a property of the session:
+ *
+ *  - @c handle() is an eventfd (a pipe outside Linux, an event on Windows)
+ *    that is readable exactly while @c Readiness::Readable holds. Register it
+ *    level-triggered; there is nothing to read from it.
+ *  - @c onReadiness() gets a callback on every change of @c readiness().
+ *  - Once @c highWaterMark() samples are queued, @c Readiness::Writable drops
+ *    and @c push() refuses input until the consumer catches up. Output past
+ *    the mark stays inside the transcoder and is pulled as @c pull() makes
+ *    room, so one push cannot queue unbounded output.
+ *  - A failed @c pull() other than end of stream or "needs input" fails the
+ *    session (see @c error()).
+ *
+ * Thread-safe: producers may push from other threads while the loop pulls.
+ * The callback runs on whichever thread caused the change, with no lock held.
+ *
+ * @code
+ * TPushSession session(encoder);
+ * epoll_event ev{EPOLLIN, {.ptr = &session}};
+ * epoll_ctl(ep, EPOLL_CTL_ADD, session.handle(), &ev);
+ * ...
+ * // on EPOLLIN:
+ * int32_t index;
+ * while (session.pull(index, sample))
+ *     send(index, sample);
+ * @endcode
+ */
+template<typename CharT = char>
+class TPushSessionT {
+    struct Pending {
+        TMediaSample sample;
+        int32_t      index = 0;
+    };
+
+    TTranscoderT<CharT>& transcoder_;
+    TMediaBufferPool     pool_;
+    detail::TReadyEvent  event_;
+    std::function<void(int32_t)> onReadiness_;
+
+    mutable std::mutex  mutex_;
+    std::deque<Pending> ready_;
+    TMediaSample        scratch_;
+    size_t              highWaterMark_;
+    bool                eos_           = false;
+    bool                failed_        = false;
+    bool                inputEnded_    = false;   // pushEos() was called
+    bool                outputPending_ = false;   // drain() stopped at the high-water mark
+    TErrorInfo          error_;
+    int32_t             readiness_ = Readiness::Writable;
+
+    int32_t computeReadiness() const {
+        int32_t r = Readiness::None;
+        if (!ready_.empty() || eos_ || failed_)
+            r |= Readiness::Readable;
+        if (ready_.size() < highWaterMark_ && !outputPending_ && !inputEnded_ && !eos_ && !failed_)
+            r |= Readiness::Writable;
+        return r;
+    }
+
+    /// Updates the event under the lock; returns the new flags if they changed, -1 otherwise.
+    int32_t refresh() {
+        const int32_t r = computeReadiness();
+        if (r == readiness_)
+            return -1;
+        readiness_ = r;
+        if (r & Readiness::Readable)
+            event_.set();
+        else
+            event_.reset();
+        return r;
+    }
+
+    void notify(int32_t changed) {
+        if (changed >= 0 && onReadiness_)
+            onReadiness_(changed);
+    }
+
+    void fail() {
+        failed_ = true;
+        error_  = transcoder_.error();
+    }
+
+    /// Moves what the transcoder has ready into the queue, up to the high-water mark.
+    void drain() {
+        int32_t index = 0;
+        while (ready_.size() < highWaterMark_) {
+            if (!transcoder_.pull(index, scratch_)) {
+                const TErrorCode code = transcoder_.errorCode();
+                if (code.isEos())
+                    eos_ = true;
+                else if (!code.needsInput() || inputEnded_)
+                    fail();
+                outputPending_ = false;
+                return;
+            }
+            Pending& out = ready_.emplace_back();
+            detail::copySample(pool_, scratch_, out.sample);
+            out.index = index;
+        }
+        outputPending_ = true;   // the rest waits in the transcoder until pull() makes room
+    }
+
+public:
+    using native_handle_type = detail::TReadyEvent::native_handle_type;
+
+    /// Wraps an opened push-mode @p transcoder, which must outlive the session.
+    /// At most @p highWaterMark pulled samples are queued before @c push() refuses input.
+    explicit TPushSessionT(TTranscoderT<CharT>& transcoder, size_t highWaterMark = 64)
+        : transcoder_(transcoder)
+        , highWaterMark_(highWaterMark ? highWaterMark : 1) {}
+
+    TPushSessionT(const TPushSessionT&) = delete;
+    TPushSessionT& operator=(const TPushSessionT&) = delete;
+
+    /// Readable while @c Readiness::Readable holds. Owned by the session.
+    native_handle_type handle() const { return event_.handle(); }
+
+    /// Sets a callback invoked with the new @c Readiness flags whenever they change.
+    /// Set it before the session is shared between threads.
+    TPushSessionT& onReadiness(std::function<void(int32_t)> callback) {
+        onReadiness_ = std::move(callback);
+        return *this;
+    }
+
+    /// Current @c Readiness flags.
+    int32_t readiness() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return readiness_;
+    }
+
+    bool readable() const { return (readiness() & Readiness::Readable) != 0; }
+    bool writable() const { return (readiness() & Readiness::Writable) != 0; }
+
+    size_t highWaterMark() const { return highWaterMark_; }
+
+    /// Pushes @p sample to input @p inputIndex and queues the output it produced, up to the mark.
+    /// Returns @c false if the session is not writable or the transcoder failed (see @c error()).
+    bool push(int32_t inputIndex, TMediaSample& sample) {
+        int32_t changed;
+        bool ok = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!(readiness_ & Readiness::Writable))
+                return false;
+            if (transcoder_.push(inputIndex, sample)) {
+                drain();
+                ok = !failed_;
+            } else {
+                fail();
+                ok = false;
+            }
+            changed = refresh();
+        }
+        notify(changed);
+        return ok;
+    }
+
+    /// Signals end of stream on every input and queues the remaining output, up to the mark.
+    bool pushEos() {
+        int32_t changed;
+        bool ok = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (inputEnded_ || failed_)
+                return !failed_;
+            inputEnded_ = true;
+            for (int32_t i = 0; ok && i < transcoder_.inputs().count(); ++i)
+                ok = transcoder_.pushEos(i);
+            if (ok) {
+                drain();
+                ok = !failed_;
+            } else {
+                fail();
+            }
+            changed = refresh();
+        }
+        notify(changed);
+        return ok;
+    }
+
+    /// Takes the oldest queued sample. Returns @c false when the queue is empty;
+    /// @c isEos() and @c failed() then tell whether more output can follow.
+    bool pull(int32_t& outputIndex, TMediaSample& sample) {
+        int32_t changed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ready_.empty())
+                return false;
+            outputIndex = ready_.front().index;
+            sample      = std::move(ready_.front().sample);
+            ready_.pop_front();
+            if (outputPending_)
+                drain();
+            changed = refresh();
+        }
+        notify(changed);
+        return true;
+    }
+
+    /// Number of samples waiting to be pulled.
+    size_t queued() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ready_.size();
+    }
+
+    /// @c true once the transcoder reached end of stream (queued samples may remain).
+    bool isEos() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return eos_;
+    }
+
+    bool failed() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return failed_;
+    }
+
+    /// Error captured when @c push(), @c pushEos() or pulling from the transcoder failed.
+    TErrorInfo error() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_;
+    }
+};
+
+using TPushSession  = TPushSessionT<char>;
+using TPushSessionW = TPushSessionT<wchar_t>;
+
+
+#if !defined(_WIN32)
+
+// ---- Asynchronous file output ----------------------------------------------
+
+/// Options for @c TUringFileStream.
+struct TUringFileOptions {
+    /// Size of each coalescing buffer. Rounded up to 4 KiB.
+    size_t  bufferSize  = size_t(1) << 20;
+    /// Number of buffers; at most this many writes are in flight.
+    int32_t bufferCount = 4;
+    /// Expected output size. When non-zero the file's blocks are reserved up
+    /// front (@c fallocate with @c FALLOC_FL_KEEP_SIZE on Linux).
+    int64_t sizeHint    = 0;
+    /// Write full, aligned buffers with @c O_DIRECT, bypassing the page cache.
+    /// Unaligned pieces (the tail, and after a seek the bytes up to the next
+    /// 4 KiB boundary) go through a second, buffered descriptor.
+    bool    direct      = false;
+    /// Use io_uring when the kernel allows it; otherwise, or when @c false,
+    /// a worker thread issues @c pwrite().
+    bool    useIoUring  = true;
+};
+
+namespace detail {
+
+#if defined(PRIMO_AVBLOCKS_HAVE_IO_URING)
+
+/// Minimal io_uring submission/completion ring over the raw system calls, so
+/// no liburing dependency is needed. Only positional writes are supported.
+class TIoUring {
+    int       ringFd_ = -1;
+    void*     sqRing_ = MAP_FAILED;
+    void*     cqRing_ = MAP_FAILED;
+    size_t    sqRingBytes_ = 0;
+    size_t    cqRingBytes_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t    sqeBytes_ = 0;
+
+    unsigned* sqTail_  = nullptr;
+    unsigned* sqMask_  = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned* cqHead_  = nullptr;
+    unsigned* cqTail_  = nullptr;
+    unsigned* cqMask_  = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    bool      fixedBuffers_ = false;
+
+    static int enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+public:
+    TIoUring() = default;
+    TIoUring(const TIoUring&) = delete;
+    TIoUring& operator=(const TIoUring&) = delete;
+
+    ~TIoUring() {
+        if (sqes_)                         ::munmap(sqes_, sqeBytes_);
+        if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) ::munmap(cqRing_, cqRingBytes_);
+        if (sqRing_ != MAP_FAILED)         ::munmap(sqRing_, sqRingBytes_);
+        if (ringFd_ >= 0)                  ::close(ringFd_);
+    }
+
+    /// Sets up a ring for @p entries writes. Returns @c false (errno set) if io_uring is unavailable.
+    bool setup(unsigned entries) {
+        io_uring_params params{};
+        ringFd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (ringFd_ < 0)
+            return false;
+
+        sqRingBytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingBytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            sqRingBytes_ = cqRingBytes_ = std::max(sqRingBytes_, cqRingBytes_);
+
+        sqRing_ = ::mmap(nullptr, sqRingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ringFd_, IORING_OFF_SQ_RING);
+        if (sqRing_ == MAP_FAILED)
+            return false;
+        cqRing_ = single ? sqRing_
+                         : ::mmap(nullptr, cqRingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+            return false;
+
+        sqeBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqeBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ringFd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return false;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<uint8_t*>(sqRing_);
+        auto* cq = static_cast<uint8_t*>(cqRing_);
+        sqTail_  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask_  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead_  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail_  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask_  = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    /// Registers the write buffers so the kernel pins them once instead of per write.
+    /// Failure (e.g. @c RLIMIT_MEMLOCK) is not fatal: plain writes are used instead.
+    void registerBuffers(const std::vector<iovec>& buffers) {
+        fixedBuffers_ = ::syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_BUFFERS,
+                                  buffers.data(), static_cast<unsigned>(buffers.size())) == 0;
+    }
+
+    /// Queues a write of registered buffer @p slot and submits it. The caller keeps
+    /// the number of writes in flight at or below the ring size.
+    bool submitWrite(int fd, const void* data, size_t bytes, int64_t offset, int32_t slot) {
+        const unsigned tail  = *sqTail_;
+        const unsigned index = tail & *sqMask_;
+        io_uring_sqe&  sqe   = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode    = fixedBuffers_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe.fd        = fd;
+        sqe.addr      = reinterpret_cast<uint64_t>(data);
+        sqe.len       = static_cast<uint32_t>(bytes);
+        sqe.off       = static_cast<uint64_t>(offset);
+        sqe.user_data = static_cast<uint64_t>(slot);
+        if (fixedBuffers_)
+            sqe.buf_index = static_cast<uint16_t>(slot);
+        sqArray_[index] = index;
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+        int rc;
+        while ((rc = enter(ringFd_, 1, 0, 0)) < 0 && errno == EINTR) {}
+        return rc >= 0;
+    }
+
+    /// Blocks until one write completes. Returns its slot and sets @p result to the
+    /// byte count or @c -errno. Returns -1 if waiting itself failed.
+    int32_t waitOne(int32_t& result) {
+        for (;;) {
+            const unsigned head = *cqHead_;
+            if (head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+                const io_uring_cqe& cqe = cqes_[head & *cqMask_];
+                const auto slot = static_cast<int32_t>(cqe.user_data);
+                result = cqe.res;
+                __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+                return slot;
+            }
+            if (enter(ringFd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+                return -1;
+        }
+    }
+};
+
+#endif // PRIMO_AVBLOCKS_HAVE_IO_URING
+
+/// Writes all of @p bytes at @p offset, retrying short writes. Returns 0 or an errno value.
+/// After a short write the rest goes to @p remainderFd when it is valid: the
+/// remainder of an @c O_DIRECT write is unaligned and needs a buffered descriptor.
+inline int positionalWrite(int fd, const uint8_t* data, size_t bytes, int64_t offset, int remainderFd = -1) {
+    while (bytes > 0) {
+        const ssize_t n = ::pwrite(fd, data, bytes, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        data   += n;
+        bytes  -= static_cast<size_t>(n);
+        offset += n;
+        if (bytes > 0 && remainderFd >= 0)
+            fd = remainderFd;
+    }
+    return 0;
+}
+
+} // namespace detail
+
+/**
+ * Output @c primo::Stream that writes a file asynchronously.
+ *
+ * Small writes (one access unit per @c write() in a pull loop, or the
+ * muxer's own writes when set as an output socket's stream) are copied into
+ * large buffers. Each full buffer is written in the background through
+ * io_uring, using registered buffers when the memlock limit allows it. When
+ * io_uring is unavailable (old kernel, seccomp, non-Linux), a worker thread
+ * issues @c pwrite() instead. The encode thread only blocks once every buffer
+ * is in flight.
+ *
+ * @c seek() waits for the writes in flight, so rewriting a header after the
+ * payload (MP4 @c moov, WAV sizes) lands after the data it overwrites.
+ * Errors from background writes surface on the next @c write(), @c seek() or
+ * @c close(); @c error() reports the first one. POSIX only. Not thread-safe:
+ * one writer, as with any @c primo::Stream.
+ *
+ * @code
+ * auto out = TUringFileStream::create("out.h264", {.sizeHint = 512 << 20});
+ * out->open();
+ * for (auto [index, sample] : encoder.samples())
+ *     out->write(sample.bytes().data(), static_cast<int32_t>(sample.bytes().size()));
+ * out->close();
+ * @endcode
+ */
+class TUringFileStream final : public detail::TRefCounted<primo::Stream> {
+    static constexpr size_t kAlignment = 4096;
+
+    struct Slot {
+        uint8_t* data     = nullptr;
+        size_t   used     = 0;
+        size_t   capacity = 0;   // bytes to fill before the slot is submitted
+        int64_t  offset   = 0;
+        bool     busy     = false;
+    };
+
+    std::filesystem::path path_;
+    TUringFileOptions     options_;
+    std::vector<Slot>     slots_;
+    int32_t               current_  = -1;
+    int32_t               inFlight_ = 0;
+    int                   fd_         = -1;   // O_DIRECT when options_.direct
+    int                   bufferedFd_ = -1;   // unaligned writes in direct mode
+    int64_t               position_ = 0;
+    int64_t               size_     = 0;
+    int                   errno_    = 0;
+    TErrorInfo            error_;
+    bool                  open_     = false;
+
+#if defined(PRIMO_AVBLOCKS_HAVE_IO_URING)
+    std::unique_ptr<detail::TIoUring> ring_;
+#endif
+
+    // pwrite fallback
+    std::thread             worker_;
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    std::deque<int32_t>     queued_;
+    std::deque<std::pair<int32_t, int>> done_;
+    bool                    stopping_ = false;
+
+    TUringFileStream(std::filesystem::path path, const TUringFileOptions& options)
+        : path_(std::move(path)), options_(options) {
+        options_.bufferSize  = (std::max<size_t>(options_.bufferSize, 1) + kAlignment - 1) / kAlignment * kAlignment;
+        options_.bufferCount = std::max<int32_t>(options_.bufferCount, 1);
+    }
+
+    ~TUringFileStream() override { close(); }
+
+    bool setError(int code, const char* hint) {
+        if (errno_ == 0) {
+            errno_ = code;
+            error_ = TErrorInfo(detail::systemFacility, code, std::system_category().message(code), std::string(hint));
+        }
+        return false;
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [this] { return stopping_ || !queued_.empty(); });
+            if (queued_.empty())
+                return;
+            const int32_t index = queued_.front();
+            queued_.pop_front();
+            const Slot slot = slots_[static_cast<size_t>(index)];
+            lock.unlock();
+            const int rc = detail::positionalWrite(fd_, slot.data, slot.used, slot.offset, bufferedFd_);
+            lock.lock();
+            done_.emplace_back(index, rc);
+            cv_.notify_all();
+        }
+    }
+
+    /// Waits for one background write and frees its slot.
+    bool reapOne() {
+        int32_t index  = -1;
+        int     status = 0;
+#if defined(PRIMO_AVBLOCKS_HAVE_IO_URING)
+        if (ring_) {
+            int32_t result = 0;
+            index = ring_->waitOne(result);
+            if (index < 0) {
+                // The ring itself failed, so no write in flight can be reaped. Count them
+                // all as failed, or drain() and close() would wait forever.
+                const int err = errno;
+                for (Slot& slot : slots_)
+                    slot.busy = false;
+                inFlight_ = 0;
+                return setError(err, "io_uring_enter");
+            }
+            Slot& slot = slots_[static_cast<size_t>(index)];
+            if (result < 0) {
+                status = -result;
+            } else if (static_cast<size_t>(result) < slot.used) {
+                // Short write: finish the remainder synchronously. In direct mode it is
+                // unaligned, so it goes through the buffered descriptor.
+                status = detail::positionalWrite(bufferedFd_ >= 0 ? bufferedFd_ : fd_, slot.data + result,
+                                                 slot.used - static_cast<size_t>(result), slot.offset + result);
+            }
+        } else
+#endif
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return !done_.empty(); });
+            std::tie(index, status) = done_.front();
+            done_.pop_front();
+        }
+
+        slots_[static_cast<size_t>(index)].busy = false;
+        --inFlight_;
+        return status == 0 || setError(status, "write");
+    }
+
+    bool drain() {
+        bool ok = true;
+        while (inFlight_ > 0)
+            ok = reapOne() && ok;
+        return ok;
+    }
+
+    /// Hands the current buffer to the background writer.
+    bool submitCurrent() {
+        if (current_ < 0)
+            return true;
+        const int32_t index = current_;
+        Slot& slot = slots_[static_cast<size_t>(index)];
+        current_ = -1;
+        if (slot.used == 0)
+            return true;
+
+        if (options_.direct && (slot.offset % kAlignment != 0 || slot.used % kAlignment != 0)) {
+            // O_DIRECT needs aligned offsets and sizes; write this piece through the page cache.
+            // Only a head up to the next boundary or a final partial buffer gets here, right
+            // after a seek or before close(), so the drain does not stall a steady write.
+            if (!drain())
+                return false;
+            const int rc = detail::positionalWrite(bufferedFd_, slot.data, slot.used, slot.offset);
+            return rc == 0 || setError(rc, "pwrite");
+        }
+
+        slot.busy = true;
+        ++inFlight_;
+#if defined(PRIMO_AVBLOCKS_HAVE_IO_URING)
+        if (ring_) {
+            if (!ring_->submitWrite(fd_, slot.data, slot.used, slot.offset, index)) {
+                slot.busy = false;
+                --inFlight_;
+                return setError(errno, "io_uring_enter");
+            }
+            return true;
+        }
+#endif
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queued_.push_back(index);
+        }
+        cv_.notify_all();
+        return true;
+    }
+
+    /// Makes a free buffer current, waiting for a write to complete if all are busy.
+    bool acquireSlot() {
+        for (;;) {
+            for (size_t i = 0; i < slots_.size(); ++i) {
+                if (!slots_[i].busy) {
+                    current_ = static_cast<int32_t>(i);
+                    slots_[i].used     = 0;
+                    slots_[i].offset   = position_;
+                    slots_[i].capacity = options_.bufferSize;
+                    // After a seek to an unaligned position, fill only up to the next
+                    // boundary: that short head is written synchronously and the
+                    // following slots are aligned again.
+                    if (options_.direct && position_ % kAlignment != 0)
+                        slots_[i].capacity = kAlignment - static_cast<size_t>(position_ % kAlignment);
+                    return true;
+                }
+            }
+            if (!reapOne())
+                return false;
+        }
+    }
+
+public:
+    /// Creates a stream that will write @p path when opened (by the SDK or by calling @c open()).
+    static primo::ref<TUringFileStream> create(std::filesystem::path path, const TUringFileOptions& options = {}) {
+        return primo::ref<TUringFileStream>(new TUringFileStream(std::move(path), options));
+    }
+
+    bool_t isOpen() const override { return open_; }
+
+    /// Creates or truncates the file and sets up the writer. On failure see @c error().
+    bool_t open() override {
+        if (open_)
+            return TRUE;
+        errno_    = 0;
+        error_    = TErrorInfo();
+        position_ = size_ = 0;
+
+        int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#if defined(O_DIRECT)
+        if (options_.direct)
+            flags |= O_DIRECT;
+#else
+        options_.direct = false;
+#endif
+        fd_ = ::open(path_.c_str(), flags, 0644);
+        if (fd_ < 0) {
+            setError(errno, "open");
+            return FALSE;
+        }
+        if (options_.direct) {
+            bufferedFd_ = ::open(path_.c_str(), O_WRONLY | O_CLOEXEC);
+            if (bufferedFd_ < 0) {
+                setError(errno, "open");
+                ::close(fd_);
+                fd_ = -1;
+                return FALSE;
+            }
+        }
+
+#if defined(__linux__)
+        if (options_.sizeHint > 0)
+            ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(options_.sizeHint));
+#endif
+
+        slots_.resize(static_cast<size_t>(options_.bufferCount));
+        for (Slot& slot : slots_) {
+            slot = Slot{};
+            slot.data = static_cast<uint8_t*>(::operator new(options_.bufferSize, std::align_val_t(kAlignment)));
+        }
+
+#if defined(PRIMO_AVBLOCKS_HAVE_IO_URING)
+        if (options_.useIoUring) {
+            ring_ = std::make_unique<detail::TIoUring>();
+            if (ring_->setup(static_cast<unsigned>(options_.bufferCount))) {
+                std::vector<iovec> buffers;
+                for (Slot& slot : slots_)
+                    buffers.push_back(iovec{slot.data, options_.bufferSize});
+                ring_->registerBuffers(buffers);
+            } else {
+                ring_.reset();
+            }
+        }
+        if (!ring_)
+#endif
+        {
+            stopping_ = false;
+            worker_   = std::thread([this] { workerLoop(); });
+        }
+
+        open_ = true;
+        return TRUE;
+    }
+
+    /// Flushes, waits for every write and closes the file.
+    void close() override {
+        if (!open_)
+            return;
+        submitCurrent();
+        drain();
+
+        if (worker_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            cv_.notify_all();
+            worker_.join();
+        }
+#if defined(PRIMO_AVBLOCKS_HAVE_IO_URING)
+        ring_.reset();
+#endif
+        if (bufferedFd_ >= 0)
+            ::close(bufferedFd_);
+        if (fd_ >= 0 && ::close(fd_) != 0)
+            setError(errno, "close");
+        fd_ = bufferedFd_ = -1;
+
+        for (Slot& slot : slots_)
+            ::operator delete(slot.data, std::align_val_t(kAlignment));
+        slots_.clear();
+        open_ = false;
+    }
+
+    bool_t canRead()  const override { return FALSE; }
+    bool_t canWrite() const override { return TRUE; }
+    bool_t canSeek()  const override { return TRUE; }
+
+    bool_t read(void*, int32_t, int32_t*) override { return FALSE; }
+
+    bool_t write(const void* buffer, int32_t dataSize) override {
+        if (!open_ || errno_ != 0 || dataSize < 0)
+            return FALSE;
+
+        auto*  src  = static_cast<const uint8_t*>(buffer);
+        size_t left = static_cast<size_t>(dataSize);
+        while (left > 0) {
+            if (current_ < 0 && !acquireSlot())
+                return FALSE;
+            Slot& slot = slots_[static_cast<size_t>(current_)];
+            const size_t count = std::min(left, slot.capacity - slot.used);
+            std::memcpy(slot.data + slot.used, src, count);
+            slot.used += count;
+            src       += count;
+            left      -= count;
+            position_ += static_cast<int64_t>(count);
+            if (slot.used == slot.capacity && !submitCurrent())
+                return FALSE;
+        }
+        size_ = std::max(size_, position_);
+        return TRUE;
+    }
+
+    int64_t size()     const override { return size_; }
+    int64_t position() const override { return position_; }
+
+    /// Waits for pending writes, then moves the cursor.
+    bool_t seek(int64_t position) override {
+        if (!open_ || position < 0)
+            return FALSE;
+        if (position == position_)
+            return TRUE;
+        if (!submitCurrent() || !drain())
+            return FALSE;
+        position_ = position;
+        return TRUE;
+    }
+
+    /// @c true if writes go through io_uring rather than the pwrite worker thread.
+    bool usesIoUring() const {
+#if defined(PRIMO_AVBLOCKS_HAVE_IO_URING)
+        return ring_ != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    /// First error from opening or writing the file, if any.
+    const TErrorInfo& error() const { return error_; }
+
+    const std::filesystem::path& path() const { return path_; }
+};
+
+
+// ---- Read-ahead input --------------------------------------------------------
+
+/// Options for @c TPrefetchStream.
+struct TPrefetchOptions {
+    /// Size of each read issued by the prefetch thread.
+    size_t  blockSize = size_t(1) << 20;
+    /// Number of blocks kept ahead of the read cursor; the window is
+    /// @c blockSize * @c blocks bytes.
+    int32_t blocks    = 8;
+};
+
+/// Counters reported by @c TPrefetchStream::stats().
+struct TPrefetchStats {
+    /// @c read() calls served entirely from the window.
+    int64_t hits      = 0;
+    /// @c read() calls that had to wait for the prefetch thread.
+    int64_t stalls    = 0;
+    /// Total time spent in those waits.
+    std::chrono::nanoseconds stallTime{};
+    /// Seeks that landed outside the window, and retries after a read error.
+    int64_t restarts  = 0;
+    /// Bytes read from the file by the prefetch thread.
+    int64_t bytesRead = 0;
+};
+
+/**
+ * Input @c primo::Stream that reads a file ahead of the SDK on a background thread.
+ *
+ * With a plain file input the decoder waits for every read, which hurts on
+ * network file systems and cold disks. This stream keeps up to
+ * @c TPrefetchOptions::blocks blocks ahead of the read cursor. A seek inside
+ * the window is served from memory. A seek outside it discards the window
+ * and restarts read-ahead at the new position, so a demuxer that jumps to
+ * an MP4 @c moov at the end pays for one stall rather than many.
+ *
+ * @c stats() tells whether a job is I/O bound: many stalls or a large
+ * @c stallTime mean the window or the storage is too slow. POSIX only.
+ *
+ * @code
+ * auto in = TPrefetchStream::create("/mnt/nfs/in.mp4", {.blocks = 16});
+ * TMediaInfo info;
+ * info.inputs(0).stream(in.get());
+ * @endcode
+ */
+class TPrefetchStream final : public detail::TRefCounted<primo::Stream> {
+    struct Block {
+        int64_t              offset = 0;
+        std::vector<uint8_t> data;
+    };
+
+    std::filesystem::path path_;
+    int                   fd_      = -1;
+    bool                  ownsFd_  = true;
+    TPrefetchOptions      options_;
+    int64_t               size_     = 0;
+    int64_t               position_ = 0;
+    bool                  open_     = false;
+    TErrorInfo            error_;
+
+    std::thread             worker_;
+    mutable std::mutex      mutex_;
+    std::condition_variable cv_;
+    std::deque<Block>       window_;       // consecutive blocks starting at the oldest unread one
+    std::vector<std::vector<uint8_t>> spare_;
+    int64_t                 nextOffset_ = 0;  // where the prefetch thread reads next
+    uint64_t                generation_ = 0;  // bumped on restart; stale reads are dropped
+    int                     readErrno_  = 0;
+    bool                    stopping_   = false;
+    TPrefetchStats          stats_;
+
+    TPrefetchStream(std::filesystem::path path, int fd, bool ownsFd, const TPrefetchOptions& options)
+        : path_(std::move(path)), fd_(fd), ownsFd_(ownsFd), options_(options) {
+        options_.blockSize = std::max<size_t>(options_.blockSize, 4096);
+        options_.blocks    = std::max<int32_t>(options_.blocks, 1);
+    }
+
+    ~TPrefetchStream() override {
+        close();
+        if (ownsFd_ && fd_ >= 0)
+            ::close(fd_);
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [this] {
+                return stopping_ || (readErrno_ == 0 && nextOffset_ < size_ &&
+                                     window_.size() < static_cast<size_t>(options_.blocks));
+            });
+            if (stopping_)
+                return;
+
+            const uint64_t generation = generation_;
+            const int64_t  offset     = nextOffset_;
+            std::vector<uint8_t> data;
+            if (!spare_.empty()) {
+                data = std::move(spare_.back());
+                spare_.pop_back();
+            }
+            data.resize(static_cast<size_t>(std::min<int64_t>(static_cast<int64_t>(options_.blockSize),
+                                                              size_ - offset)));
+            lock.unlock();
+
+            size_t got = 0;
+            int    err = 0;
+            while (got < data.size()) {
+                const ssize_t n = ::pread(fd_, data.data() + got, data.size() - got,
+                                          static_cast<off_t>(offset + static_cast<int64_t>(got)));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0) {
+                    err = n < 0 ? errno : 0;
+                    break;
+                }
+                got += static_cast<size_t>(n);
+            }
+            data.resize(got);
+
+            lock.lock();
+            if (generation != generation_) {
+                spare_.push_back(std::move(data));
+                continue;
+            }
+            stats_.bytesRead += static_cast<int64_t>(got);
+            if (got == 0) {
+                if (err != 0) {
+                    // Possibly transient (EIO, ESTALE on NFS): keep the size and stop until
+                    // the reader has reported the error and restarted read-ahead.
+                    readErrno_ = err;
+                } else {
+                    size_ = offset;   // the file shrank
+                }
+                spare_.push_back(std::move(data));
+            } else {
+                nextOffset_ = offset + static_cast<int64_t>(got);
+                window_.push_back(Block{offset, std::move(data)});
+            }
+            cv_.notify_all();
+        }
+    }
+
+    /// Discards the window and restarts read-ahead at @p offset. Caller holds the lock.
+    void restartAt(int64_t offset) {
+        for (Block& block : window_)
+            spare_.push_back(std::move(block.data));
+        window_.clear();
+        ++generation_;
+        nextOffset_ = offset;
+        readErrno_  = 0;
+        ++stats_.restarts;
+        cv_.notify_all();
+    }
+
+    /// Drops blocks that end at or before the cursor so the thread can refill. Caller holds the lock.
+    void dropConsumed() {
+        bool dropped = false;
+        while (!window_.empty() &&
+               window_.front().offset + static_cast<int64_t>(window_.front().data.size()) <= position_) {
+            spare_.push_back(std::move(window_.front().data));
+            window_.pop_front();
+            dropped = true;
+        }
+        if (dropped)
+            cv_.notify_all();
+    }
+
+public:
+    /// Creates a stream that opens @p path when opened (by the SDK or by calling @c open()).
+    static primo::ref<TPrefetchStream> create(std::filesystem::path path, const TPrefetchOptions& options = {}) {
+        return primo::ref<TPrefetchStream>(new TPrefetchStream(std::move(path), -1, true, options));
+    }
+
+    /// Creates a stream over the open, seekable descriptor @p fd. With @p ownsFd the
+    /// stream closes it when destroyed.
+    static primo::ref<TPrefetchStream> create(int fd, bool ownsFd, const TPrefetchOptions& options = {}) {
+        return primo::ref<TPrefetchStream>(new TPrefetchStream({}, fd, ownsFd, options));
+    }
+
+    bool_t isOpen() const override { return open_; }
+
+    /// Opens the file (if created from a path), reads its size and starts prefetching from offset 0.
+    bool_t open() override {
+        if (open_)
+            return TRUE;
+        if (fd_ < 0) {
+            fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd_ < 0) {
+                error_ = detail::systemError("open");
+                return FALSE;
+            }
+        }
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0) {
+            error_ = detail::systemError("fstat");
+            return FALSE;
+        }
+#if defined(POSIX_FADV_SEQUENTIAL)
+        ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+        size_       = static_cast<int64_t>(st.st_size);
+        position_   = 0;
+        nextOffset_ = 0;
+        readErrno_  = 0;
+        stopping_   = false;
+        stats_      = TPrefetchStats{};
+        worker_     = std::thread([this] { workerLoop(); });
+        open_       = true;
+        return TRUE;
+    }
+
+    /// Stops the prefetch thread and drops the window. A descriptor opened from a
+    /// path is closed; one passed to @c create() stays open until destruction.
+    void close() override {
+        if (!open_)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            for (Block& block : window_)
+                spare_.push_back(std::move(block.data));
+            window_.clear();
+            ++generation_;
+        }
+        cv_.notify_all();
+        worker_.join();
+        if (!path_.empty() && fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        open_ = false;
+    }
+
+    bool_t canRead()  const override { return TRUE; }
+    bool_t canWrite() const override { return FALSE; }
+    bool_t canSeek()  const override { return TRUE; }
+
+    bool_t read(void* buffer, int32_t bufferSize, int32_t* totalRead) override {
+        if (!open_ || bufferSize < 0 || !totalRead)
+            return FALSE;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        const int64_t want = std::min<int64_t>(bufferSize, std::max<int64_t>(size_ - position_, 0));
+        auto*   dst    = static_cast<uint8_t*>(buffer);
+        int64_t copied = 0;
+        bool    waited = false;
+        std::chrono::steady_clock::time_point waitStart;
+
+        while (copied < want) {
+            dropConsumed();
+            // After dropConsumed() the front block, if any, ends past the cursor. An empty
+            // window is still on track if the thread is about to read at the cursor.
+            const bool inWindow = window_.empty() ? nextOffset_ == position_
+                                                  : window_.front().offset <= position_;
+            if (!inWindow)
+                restartAt(position_);
+
+            if (window_.empty()) {
+                if (readErrno_ != 0) {
+                    error_ = TErrorInfo(detail::systemFacility, readErrno_,
+                                        std::system_category().message(readErrno_), "pread");
+                    restartAt(position_);   // the next read() tries again
+                    break;
+                }
+                if (position_ >= size_)
+                    break;   // the file shrank under the cursor
+                if (!waited) {
+                    waited    = true;
+                    waitStart = std::chrono::steady_clock::now();
+                }
+                cv_.wait(lock, [this] { return !window_.empty() || readErrno_ != 0 || position_ >= size_; });
+                continue;
+            }
+
+            const Block&  block = window_.front();
+            const int64_t skip  = position_ - block.offset;
+            const int64_t count = std::min<int64_t>(want - copied,
+                                                    static_cast<int64_t>(block.data.size()) - skip);
+            std::memcpy(dst + copied, block.data.data() + skip, static_cast<size_t>(count));
+            copied    += count;
+            position_ += count;
+        }
+        dropConsumed();
+
+        if (waited) {
+            ++stats_.stalls;
+            stats_.stallTime += std::chrono::steady_clock::now() - waitStart;
+        } else if (copied > 0) {
+            ++stats_.hits;
+        }
+        *totalRead = static_cast<int32_t>(copied);
+        return copied == want ? TRUE : FALSE;
+    }
+
+    bool_t write(const void*, int32_t) override { return FALSE; }
+
+    int64_t size() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+
+    int64_t position() const override { return position_; }
+
+    /// Moves the cursor. Positions inside the window keep the prefetched data;
+    /// the next @c read() elsewhere restarts read-ahead there.
+    bool_t seek(int64_t position) override {
+        if (!open_ || position < 0)
+            return FALSE;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (position > size_)
+            return FALSE;
+        position_ = position;
+        return TRUE;
+    }
+
+    /// Counters since @c open().
+    TPrefetchStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    /// Error from opening or reading the file, if any.
+    const TErrorInfo& error() const { return error_; }
+};
+
+
+// ---- Pipes and standard streams ----------------------------------------------
+
+/// Options for @c TPipeStream.
+struct TPipeOptions {
+    /// Requested kernel pipe buffer size (@c F_SETPIPE_SZ, Linux only; 0 keeps
+    /// the default). Larger buffers mean fewer context switches between the
+    /// processes of a shell pipeline. Capped by @c /proc/sys/fs/pipe-max-size.
+    int32_t pipeSize  = 1 << 20;
+    /// Input only: the first @c probeSize bytes are kept so the stream can be
+    /// reopened or rewound for a second pass over the start, which is how
+    /// @c TMediaInfo detection followed by a transcoder input works.
+    size_t  probeSize = size_t(1) << 20;
+};
+
+/**
+ * @c primo::Stream over a pipe or another non-seekable descriptor, such as
+ * stdin and stdout of a shell pipeline.
+ *
+ * Reads and writes loop until the request is complete, so short pipe
+ * transfers are invisible to the SDK. @c canSeek() is @c false. An output
+ * socket that writes a container which needs seeking (MP4 and similar, see
+ * @c requiresSeekableOutput()) makes @c TTranscoder::open() fail immediately
+ * instead of at the end of the job; choose MPEG-TS, WebM, Ogg or an
+ * elementary stream for piped output.
+ *
+ * An input keeps the first @c TPipeOptions::probeSize bytes. While nothing
+ * past them has been read, @c open() rewinds to the start and @c seek()
+ * works inside them. Format detection can then read the head of the stream
+ * and the transcoder can read it again.
+ *
+ * Data is copied with read()/write(). vmsplice() is not used because the SDK
+ * reuses its buffers as soon as @c write() returns. POSIX only.
+ *
+ * @code
+ * auto in  = TPipeStream::standardInput();
+ * auto out = TPipeStream::standardOutput();
+ * TMediaInfo info;
+ * info.inputs(0).stream(in.get());
+ * info.open();
+ * TTranscoder()
+ *     .addInput(TMediaSocket(info).stream(in.get()))
+ *     .addOutput(TMediaSocket(Preset::Audio::Generic::MP3).stream(out.get()))
+ *     .open()
+ *     .run();
+ * @endcode
+ */
+class TPipeStream final : public detail::TRefCounted<primo::Stream> {
+    int                  fd_;
+    bool                 ownsFd_;
+    bool                 writable_;
+    TPipeOptions         options_;
+    bool                 open_     = false;
+    int64_t              position_ = 0;    // logical cursor
+    int64_t              consumed_ = 0;    // bytes taken from (or written to) the descriptor
+    std::vector<uint8_t> probe_;           // first bytes read, for rewinds
+    TErrorInfo           error_;
+
+    TPipeStream(int fd, bool ownsFd, bool writable, const TPipeOptions& options)
+        : fd_(fd), ownsFd_(ownsFd), writable_(writable), options_(options) {}
+
+    ~TPipeStream() override {
+        if (ownsFd_ && fd_ >= 0)
+            ::close(fd_);
+    }
+
+    void fail(const char* hint) {
+        error_ = detail::systemError(hint);
+    }
+
+    /// Reads up to @p bytes from the descriptor, looping over short reads. Returns -1 on error.
+    int64_t readFully(uint8_t* dst, size_t bytes) {
+        size_t got = 0;
+        while (got < bytes) {
+            const ssize_t n = ::read(fd_, dst + got, bytes - got);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                fail("read");
+                return -1;
+            }
+            if (n == 0)
+                break;
+            got += static_cast<size_t>(n);
+        }
+        return static_cast<int64_t>(got);
+    }
+
+    /// The probe prefix is intact while nothing beyond it has been consumed.
+    bool canRewind() const {
+        return consumed_ == static_cast<int64_t>(probe_.size());
+    }
+
+public:
+    /// Wraps @p fd for reading. With @p ownsFd the stream closes it when destroyed.
+    static primo::ref<TPipeStream> forReading(int fd, bool ownsFd = false, const TPipeOptions& options = {}) {
+        return primo::ref<TPipeStream>(new TPipeStream(fd, ownsFd, false, options));
+    }
+
+    /// Wraps @p fd for writing. With @p ownsFd the stream closes it when destroyed.
+    static primo::ref<TPipeStream> forWriting(int fd, bool ownsFd = false, const TPipeOptions& options = {}) {
+        return primo::ref<TPipeStream>(new TPipeStream(fd, ownsFd, true, options));
+    }
+
+    static primo::ref<TPipeStream> standardInput(const TPipeOptions& options = {}) {
+        return forReading(STDIN_FILENO, false, options);
+    }
+
+    static primo::ref<TPipeStream> standardOutput(const TPipeOptions& options = {}) {
+        return forWriting(STDOUT_FILENO, false, options);
+    }
+
+    bool_t isOpen() const override { return open_; }
+
+    /// Enlarges the pipe buffer on first open. Reopening an input rewinds to the
+    /// start if the probe prefix is still intact, and fails otherwise.
+    bool_t open() override {
+        if (fd_ < 0)
+            return FALSE;
+        if (consumed_ == 0) {
+#if defined(F_SETPIPE_SZ)
+            struct stat st{};
+            if (options_.pipeSize > 0 && ::fstat(fd_, &st) == 0 && S_ISFIFO(st.st_mode))
+                ::fcntl(fd_, F_SETPIPE_SZ, options_.pipeSize);
+#endif
+        } else if (writable_ || !canRewind()) {
+            return FALSE;
+        }
+        position_ = 0;
+        open_     = true;
+        return TRUE;
+    }
+
+    void close() override { open_ = false; }
+
+    bool_t canRead()  const override { return !writable_; }
+    bool_t canWrite() const override { return writable_; }
+    bool_t canSeek()  const override { return FALSE; }
+
+    bool_t read(void* buffer, int32_t bufferSize, int32_t* totalRead) override {
+        if (!open_ || writable_ || bufferSize < 0 || !totalRead)
+            return FALSE;
+
+        auto*  dst  = static_cast<uint8_t*>(buffer);
+        size_t done = 0;
+
+        // Replay from the probe prefix after a rewind.
+        if (position_ < consumed_) {
+            const size_t count = std::min(static_cast<size_t>(bufferSize),
+                                          static_cast<size_t>(consumed_ - position_));
+            std::memcpy(dst, probe_.data() + position_, count);
+            done      += count;
+            position_ += static_cast<int64_t>(count);
+        }
+
+        if (done < static_cast<size_t>(bufferSize)) {
+            const int64_t got = readFully(dst + done, static_cast<size_t>(bufferSize) - done);
+            if (got < 0)
+                return FALSE;
+            if (canRewind() && probe_.size() < options_.probeSize) {
+                const size_t keep = std::min(static_cast<size_t>(got), options_.probeSize - probe_.size());
+                probe_.insert(probe_.end(), dst + done, dst + done + keep);
+            }
+            consumed_ += got;
+            position_ += got;
+            done      += static_cast<size_t>(got);
+        }
+
+        *totalRead = static_cast<int32_t>(done);
+        return TRUE;
+    }
+
+    bool_t write(const void* buffer, int32_t dataSize) override {
+        if (!open_ || !writable_ || dataSize < 0)
+            return FALSE;
+        auto*  src  = static_cast<const uint8_t*>(buffer);
+        size_t left = static_cast<size_t>(dataSize);
+        while (left > 0) {
+            const ssize_t n = ::write(fd_, src, left);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                fail("write");
+                return FALSE;
+            }
+            src  += n;
+            left -= static_cast<size_t>(n);
+        }
+        consumed_ += dataSize;
+        position_ += dataSize;
+        return TRUE;
+    }
+
+    /// Bytes written so far for an output; -1 (unknown) for an input.
+    int64_t size() const override { return writable_ ? consumed_ : -1; }
+
+    int64_t position() const override { return position_; }
+
+    /// Only "seeks" that do not move are accepted, plus rewinds inside an intact
+    /// probe prefix of an input.
+    bool_t seek(int64_t position) override {
+        if (position == position_)
+            return TRUE;
+        if (writable_ || position < 0 || !canRewind() || position > consumed_)
+            return FALSE;
+        position_ = position;
+        return TRUE;
+    }
+
+    /// Last system error from reading or writing the descriptor.
+    const TErrorInfo& error() const { return error_; }
+
+    int fd() const { return fd_; }
+};
+
+#endif // !_WIN32
+
+
+// ---- Checksums ---------------------------------------------------------------
+
+namespace detail {
+
+#if defined(PRIMO_AVBLOCKS_X86)
+/// CPU features used by the checksum kernels, detected once.
+struct TCpuFeatures {
+    bool sse42 = false;
+    bool sha   = false;
+
+    static const TCpuFeatures& get() {
+        static const TCpuFeatures features = detect();
+        return features;
+    }
+
+private:
+    static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int r[4];
+        __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (int i = 0; i < 4; ++i)
+            regs[i] = static_cast<uint32_t>(r[i]);
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    static TCpuFeatures detect() {
+        TCpuFeatures f;
+        uint32_t r[4];
+        cpuid(0, 0, r);
+        const uint32_t maxLeaf = r[0];
+        if (maxLeaf < 1)
+            return f;
+        cpuid(1, 0, r);
+        const bool ssse3 = (r[2] >> 9) & 1;
+        const bool sse41 = (r[2] >> 19) & 1;
+        f.sse42 = (r[2] >> 20) & 1;
+        if (maxLeaf >= 7) {
+            cpuid(7, 0, r);
+            f.sha = ((r[1] >> 29) & 1) && ssse3 && sse41;
+        }
+        return f;
+    }
+};
+#endif
+
+/// CRC-32C (Castagnoli), using the SSE4.2 @c crc32 instruction when available.
+class TCrc32c {
+    uint32_t crc_ = 0xFFFFFFFFu;
+
+    static const uint32_t* table() {
+        static const auto t = [] {
+            std::array<uint32_t, 256> values{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+                values[i] = c;
+            }
+            return values;
+        }();
+        return t.data();
+    }
+
+    static uint32_t software(uint32_t crc, const uint8_t* data, size_t size) {
+        const uint32_t* t = table();
+        for (size_t i = 0; i < size; ++i)
+            crc = t[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+#if defined(PRIMO_AVBLOCKS_X86)
+    PRIMO_AVBLOCKS_TARGET("sse4.2")
+    static uint32_t hardware(uint32_t crc, const uint8_t* data, size_t size) {
+    #if defined(__x86_64__) || defined(_M_X64)
+        uint64_t c = crc;
+        for (; size >= 8; data += 8, size -= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, 8);
+            c = _mm_crc32_u64(c, word);
+        }
+        crc = static_cast<uint32_t>(c);
+    #endif
+        for (; size >= 4; data += 4, size -= 4) {
+            uint32_t word;
+            std::memcpy(&word, data, 4);
+            crc = _mm_crc32_u32(crc, word);
+        }
+        for (; size > 0; ++data, --size)
+            crc = _mm_crc32_u8(crc, *data);
+        return crc;
+    }
+#endif
+
+public:
+    /// Set @p useHardware to @c false to force the table implementation.
+    void update(const void* data, size_t size, bool useHardware = true) {
+        auto* bytes = static_cast<const uint8_t*>(data);
+#if defined(PRIMO_AVBLOCKS_X86)
+        if (useHardware && TCpuFeatures::get().sse42) {
+            crc_ = hardware(crc_, bytes, size);
+            return;
+        }
+#else
+        (void)useHardware;
+#endif
+        crc_ = software(crc_, bytes, size);
+    }
+
+    uint32_t value() const { return ~crc_; }
+    void     reset()       { crc_ = 0xFFFFFFFFu; }
+
+    /// Whether @c update() uses the SSE4.2 instruction on this CPU.
+    static bool hardwareAccelerated() {
+#if defined(PRIMO_AVBLOCKS_X86)
+        return TCpuFeatures::get().sse42;
+#else
+        return false;
+#endif
+    }
+};
+
+/// SHA-256, using the x86 SHA extensions (SHA-NI) when available.
+class TSha256 {
+    static constexpr uint32_t kRound[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    uint32_t state_[8];
+    uint8_t  block_[64];
+    size_t   blockUsed_ = 0;
+    uint64_t totalBytes_ = 0;
+    bool     useHardware_ = true;
+
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    static void software(uint32_t state[8], const uint8_t* data, size_t blocks) {
+        for (; blocks > 0; --blocks, data += 64) {
+            uint32_t w[64];
+            for (int i = 0; i < 16; ++i) {
+                w[i] = (uint32_t(data[4 * i]) << 24) | (uint32_t(data[4 * i + 1]) << 16) |
+                       (uint32_t(data[4 * i + 2]) << 8) | uint32_t(data[4 * i + 3]);
+            }
+            for (int i = 16; i < 64; ++i) {
+                const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; ++i) {
+                const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                                    kRound[i] + w[i];
+                const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+    }
+
+#if defined(PRIMO_AVBLOCKS_X86)
+    PRIMO_AVBLOCKS_TARGET("sha,ssse3,sse4.1")
+    static void hardware(uint32_t state[8], const uint8_t* data, size_t blocks) {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+        // The SHA instructions keep the state as ABEF / CDGH.
+        __m128i tmp    = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+        state1         = _mm_blend_epi16(state1, tmp, 0xF0);
+
+        for (; blocks > 0; --blocks, data += 64) {
+            const __m128i abef = state0;
+            const __m128i cdgh = state1;
+            __m128i w[4];
+
+            for (int i = 0; i < 16; ++i) {
+                __m128i& words = w[i & 3];
+                if (i < 4) {
+                    words = _mm_shuffle_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), byteSwap);
+                } else {
+                    // w[t] = sigma1(w[t-2]) + w[t-7] + sigma0(w[t-15]) + w[t-16], four words at a time.
+                    __m128i next = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                    next  = _mm_add_epi32(next, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                    words = _mm_sha256msg2_epu32(next, w[(i + 3) & 3]);
+                }
+
+                __m128i msg = _mm_add_epi32(words, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&kRound[4 * i])));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                msg    = _mm_shuffle_epi32(msg, 0x0E);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            }
+
+            state0 = _mm_add_epi32(state0, abef);
+            state1 = _mm_add_epi32(state1, cdgh);
+        }
+
+        tmp    = _mm_shuffle_epi32(state0, 0x1B);
+        state1 = _mm_shuffle_epi32(state1, 0xB1);
+        state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+        state1 = _mm_alignr_epi8(state1, tmp, 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+    }
+#endif
+
+    void compress(const uint8_t* data, size_t blocks) {
+#if defined(PRIMO_AVBLOCKS_X86)
+        if (useHardware_ && TCpuFeatures::get().sha) {
+            hardware(state_, data, blocks);
+            return;
+        }
+#endif
+        software(state_, data, blocks);
+    }
+
+public:
+    /// Set @p useHardware to @c false to force the portable implementation.
+    explicit TSha256(bool useHardware = true) : useHardware_(useHardware) { reset(); }
+
+    void reset() {
+        static constexpr uint32_t init[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+        };
+        std::memcpy(state_, init, sizeof(state_));
+        blockUsed_  = 0;
+        totalBytes_ = 0;
+    }
+
+    void update(const void* data, size_t size) {
+        auto* bytes = static_cast<const uint8_t*>(data);
+        totalBytes_ += size;
+
+        if (blockUsed_ > 0) {
+            const size_t count = std::min(size, 64 - blockUsed_);
+            std::memcpy(block_ + blockUsed_, bytes, count);
+            blockUsed_ += count;
+            bytes      += count;
+            size       -= count;
+            if (blockUsed_ < 64)
+                return;
+            compress(block_, 1);
+            blockUsed_ = 0;
+        }
+
+        if (size >= 64) {
+            compress(bytes, size / 64);
+            bytes += size / 64 * 64;
+            size  %= 64;
+        }
+
+        std::memcpy(block_, bytes, size);
+        blockUsed_ = size;
+    }
+
+    /// Returns the digest of everything passed to @c update(). Does not modify the state.
+    std::array<uint8_t, 32> digest() const {
+        TSha256 tail = *this;
+        const uint64_t bits = tail.totalBytes_ * 8;
+
+        uint8_t pad[72] = {0x80};
+        const size_t padBytes = (tail.blockUsed_ < 56 ? 56 : 120) - tail.blockUsed_;
+        for (int i = 0; i < 8; ++i)
+            pad[padBytes + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        tail.update(pad, padBytes + 8);
+
+        std::array<uint8_t, 32> out{};
+        for (int i = 0; i < 8; ++i) {
+            out[4 * i]     = static_cast<uint8_t>(tail.state_[i] >> 24);
+            out[4 * i + 1] = static_cast<uint8_t>(tail.state_[i] >> 16);
+            out[4 * i + 2] = static_cast<uint8_t>(tail.state_[i] >> 8);
+            out[4 * i + 3] = static_cast<uint8_t>(tail.state_[i]);
+        }
+        return out;
+    }
+
+    /// Whether @c update() uses the SHA extensions on this CPU.
+    static bool hardwareAccelerated() {
+#if defined(PRIMO_AVBLOCKS_X86)
+        return TCpuFeatures::get().sha;
+#else
+        return false;
+#endif
+    }
+};
+
+} // namespace detail
+
+// ---- Tee output --------------------------------------------------------------
+
+/// Checksums computed by @c TTeeStream. Values may be combined.
+struct TeeDigest {
+    enum Enum {
+        None   = 0,
+        CRC32C = 1,
+        SHA256 = 2,
+    };
+};
+
+/**
+ * Output @c primo::Stream that writes to several sinks at once and computes
+ * checksums of the output as it is written.
+ *
+ * Every @c open(), @c write(), @c seek() and @c close() is forwarded to all
+ * sinks (any @c primo::Stream: @c TMemoryStream, @c TUringFileStream,
+ * @c TPipeStream, ...), so one transcode can produce, say, a local file and an
+ * in-memory copy for upload. CRC-32C (SSE4.2) and SHA-256 (SHA-NI) are
+ * computed inline, which removes the extra read pass over the output.
+ *
+ * Muxers that seek back to patch headers (MP4, WAVE, ...) break the
+ * in-order hash. The tee then re-reads the output when it closes, from
+ * the first sink that can read and seek. If none can, @c digestsValid()
+ * is @c false until @c rehash() is given a reader for the finished output.
+ * Sequential outputs (MPEG-TS, pipes) never need the extra pass.
+ *
+ * @code
+ * auto file = TUringFileStream::create("out.ts");
+ * auto copy = TMemoryStream::create();
+ * auto tee  = TTeeStream::create({file.get(), copy.get()});
+ * ... transcode into TMediaSocket(...).stream(tee.get()) ...
+ * std::string sha = tee->sha256Hex();
+ * @endcode
+ */
+class TTeeStream final : public detail::TRefCounted<primo::Stream> {
+    std::vector<primo::ref<primo::Stream>> sinks_;
+    int32_t  digests_;
+    bool     open_     = false;
+    int64_t  position_ = 0;
+    int64_t  size_     = 0;
+    int64_t  hashedUpTo_ = 0;
+    bool     dirty_    = false;   // a write did not append at hashedUpTo_
+    int32_t  failedSink_ = -1;
+
+    detail::TCrc32c crc_;
+    detail::TSha256 sha_;
+
+    TTeeStream(std::span<primo::Stream* const> sinks, int32_t digests) : digests_(digests) {
+        for (primo::Stream* sink : sinks) {
+            sink->retain();
+            sinks_.emplace_back(sink);
+        }
+    }
+
+    void resetDigests() {
+        crc_.reset();
+        sha_.reset();
+        hashedUpTo_ = 0;
+        dirty_      = false;
+    }
+
+    void hash(const void* data, size_t size) {
+        if (digests_ & TeeDigest::CRC32C)
+            crc_.update(data, size);
+        if (digests_ & TeeDigest::SHA256)
+            sha_.update(data, size);
+        hashedUpTo_ += static_cast<int64_t>(size);
+    }
+
+public:
+    /// Creates a tee over @p sinks, which it retains. @p digests is a combination of
+    /// @c TeeDigest values.
+    static primo::ref<TTeeStream> create(std::initializer_list<primo::Stream*> sinks,
+                                         int32_t digests = TeeDigest::CRC32C | TeeDigest::SHA256) {
+        return create(std::span<primo::Stream* const>(sinks.begin(), sinks.size()), digests);
+    }
+
+    static primo::ref<TTeeStream> create(std::span<primo::Stream* const> sinks,
+                                         int32_t digests = TeeDigest::CRC32C | TeeDigest::SHA256) {
+        return primo::ref<TTeeStream>(new TTeeStream(sinks, digests));
+    }
+
+    bool_t isOpen() const override { return open_; }
+
+    /// Opens every sink that is not open yet and restarts the checksums.
+    bool_t open() override {
+        for (size_t i = 0; i < sinks_.size(); ++i) {
+            if (!sinks_[i]->isOpen() && !sinks_[i]->open()) {
+                failedSink_ = static_cast<int32_t>(i);
+                return FALSE;
+            }
+        }
+        position_   = 0;
+        size_       = 0;
+        failedSink_ = -1;
+        resetDigests();
+        open_ = true;
+        return TRUE;
+    }
+
+    /// Finishes the checksums (re-reading a sink if the output was patched), then closes every sink.
+    void close() override {
+        if (!open_)
+            return;
+        if (dirty_ && digests_ != TeeDigest::None) {
+            for (auto& sink : sinks_) {
+                if (sink->canRead() && sink->canSeek()) {
+                    rehash(*sink);
+                    break;
+                }
+            }
+        }
+        for (auto& sink : sinks_)
+            sink->close();
+        open_ = false;
+    }
+
+    bool_t canRead()  const override { return FALSE; }
+    bool_t canWrite() const override { return TRUE; }
+
+    /// Seekable only if every sink is.
+    bool_t canSeek() const override {
+        for (const auto& sink : sinks_) {
+            if (!sink->canSeek())
+                return FALSE;
+        }
+        return TRUE;
+    }
+
+    bool_t read(void*, int32_t, int32_t*) override { return FALSE; }
+
+    bool_t write(const void* buffer, int32_t dataSize) override {
+        if (!open_ || dataSize < 0)
+            return FALSE;
+        for (size_t i = 0; i < sinks_.size(); ++i) {
+            if (!sinks_[i]->write(buffer, dataSize)) {
+                failedSink_ = static_cast<int32_t>(i);
+                return FALSE;
+            }
+        }
+
+        if (!dirty_) {
+            if (position_ == hashedUpTo_)
+                hash(buffer, static_cast<size_t>(dataSize));
+            else
+                dirty_ = true;
+        }
+        position_ += dataSize;
+        size_ = std::max(size_, position_);
+        return TRUE;
+    }
+
+    int64_t size()     const override { return size_; }
+    int64_t position() const override { return position_; }
+
+    bool_t seek(int64_t position) override {
+        if (!open_ || position < 0)
+            return FALSE;
+        for (size_t i = 0; i < sinks_.size(); ++i) {
+            if (!sinks_[i]->seek(position)) {
+                failedSink_ = static_cast<int32_t>(i);
+                return FALSE;
+            }
+        }
+        position_ = position;
+        return TRUE;
+    }
+
+    /**
+     * Recomputes the checksums by reading the finished output from @p reader,
+     * which is opened if needed and read from offset 0 up to @c size(). Use it
+     * after @c close() when no sink could be read back. Returns @c false if
+     * @p reader could not supply @c size() bytes.
+     */
+    bool rehash(primo::Stream& reader) {
+        if (!reader.isOpen() && !reader.open())
+            return false;
+        if (!reader.seek(0))
+            return false;
+
+        resetDigests();
+        std::vector<uint8_t> chunk(size_t(1) << 20);
+        while (hashedUpTo_ < size_) {
+            const auto want = static_cast<int32_t>(std::min<int64_t>(static_cast<int64_t>(chunk.size()),
+                                                                     size_ - hashedUpTo_));
+            int32_t got = 0;
+            if (!reader.read(chunk.data(), want, &got) || got <= 0) {
+                dirty_ = true;
+                return false;
+            }
+            hash(chunk.data(), static_cast<size_t>(got));
+        }
+        reader.seek(position_);
+        return true;
+    }
+
+    /// @c true when the checksums cover the whole output as it is now.
+    bool digestsValid() const { return !dirty_ && hashedUpTo_ == size_; }
+
+    /// CRC-32C of the output (see @c digestsValid()).
+    uint32_t crc32c() const { return crc_.value(); }
+
+    /// SHA-256 of the output (see @c digestsValid()).
+    std::array<uint8_t, 32> sha256() const { return sha_.digest(); }
+
+    /// SHA-256 as lowercase hex.
+    std::string sha256Hex() const {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        for (uint8_t byte : sha256()) {
+            hex.push_back(digits[byte >> 4]);
+            hex.push_back(digits[byte & 0xF]);
+        }
+        return hex;
+    }
+
+    size_t sinkCount() const { return sinks_.size(); }
+
+    /// Index of the sink whose last operation failed, or -1.
+    int32_t failedSink() const { return failedSink_; }
+};
+
+
+// ---- HTTP range input --------------------------------------------------------
+
+/// Result of one @c TRangeFetcher call.
+struct TFetchStatus {
+    enum Enum {
+        Ok    = 0,
+        /// Transient failure (connection error, timeout, HTTP 408/429/5xx): try again.
+        Retry = 1,
+        /// Permanent failure (HTTP 4xx, malformed response): give up.
+        Fail  = 2,
+    };
+};
+
+/// Facility of the @c TErrorInfo the built-in HTTP client reports for HTTP and
+/// name-resolution failures (the value spells "HTTP"). The code is the HTTP
+/// status for error responses, the @c getaddrinfo() @c EAI_* code for resolver
+/// failures, and 0 for malformed, truncated or unusable responses. Socket
+/// errors keep the OS facility (@c ErrorFacility::SystemUnix).
+inline constexpr int32_t httpErrorFacility = 0x48545450;
+
+/**
+ * Fetches @p length bytes at @p offset of a remote object into @p data.
+ *
+ * Must resize @p data to the bytes returned. That is @p length, except at the
+ * end of the object. Sets @p totalSize to the object size when the response
+ * reports it, and fills @p error on failure. Called concurrently from
+ * several threads. If the first response reports no size, it must be
+ * shorter than @p length (the whole object); otherwise @c open() fails.
+ */
+using TRangeFetcher = std::function<TFetchStatus::Enum(int64_t offset, size_t length, std::vector<uint8_t>& data,
+                                                       int64_t& totalSize, TErrorInfo& error)>;
+
+/// Options for @c THttpRangeStream.
+struct THttpRangeOptions {
+    /// Size of each range request and cache block.
+    size_t  blockSize      = size_t(1) << 20;
+    /// Blocks requested ahead of the read cursor.
+    int32_t prefetchBlocks = 4;
+    /// Parallel requests (one fetch thread each).
+    int32_t connections    = 4;
+    /// Blocks kept in the cache (least recently used ones are dropped).
+    int32_t cacheBlocks    = 32;
+    /// Extra attempts after a failure the fetcher reports as transient.
+    int32_t retries        = 3;
+    /// Delay before the first retry; doubled for each further one.
+    std::chrono::milliseconds retryDelay{200};
+    /// Socket send/receive timeout of the built-in HTTP client.
+    std::chrono::milliseconds timeout{10000};
+    /// Fetch the last block right after opening, where MP4 files often keep
+    /// the @c moov atom that the demuxer seeks to first.
+    bool    prefetchTail   = true;
+};
+
+/// Counters reported by @c THttpRangeStream::stats().
+struct THttpRangeStats {
+    /// @c read() calls served entirely from the cache.
+    int64_t hits         = 0;
+    /// @c read() calls that waited for a request.
+    int64_t stalls       = 0;
+    /// Total time spent in those waits.
+    std::chrono::nanoseconds stallTime{};
+    /// Range requests issued, including retries.
+    int64_t requests     = 0;
+    int64_t retries      = 0;
+    int64_t bytesFetched = 0;
+};
+
+#if !defined(_WIN32)
+namespace detail {
+
+/// Parsed @c http:// URL.
+struct THttpUrl {
+    std::string host;
+    std::string port = "80";
+    std::string path = "/";
+
+    static THttpUrl parse(const std::string& url) {
+        static const std::string scheme = "http://";
+        if (url.compare(0, scheme.size(), scheme) != 0)
+            throw std::invalid_argument("Only http:// URLs are supported; pass a TRangeFetcher for other schemes");
+
+        THttpUrl result;
+        const size_t hostStart = scheme.size();
+        const size_t pathStart = url.find('/', hostStart);
+        std::string authority = url.substr(hostStart, pathStart == std::string::npos ? std::string::npos
+                                                                                     : pathStart - hostStart);
+        if (pathStart != std::string::npos)
+            result.path = url.substr(pathStart);
+
+        size_t portSep = authority.rfind(':');
+        if (!authority.empty() && authority.front() == '[') {
+            // IPv6 literal: [::1]:8080
+            const size_t close = authority.find(']');
+            if (close == std::string::npos)
+                throw std::invalid_argument("Malformed URL: " + url);
+            result.host = authority.substr(1, close - 1);
+            portSep = authority.size() > close + 1 && authority[close + 1] == ':' ? close + 1 : std::string::npos;
+        } else {
+            result.host = authority.substr(0, portSep);
+        }
+        if (portSep != std::string::npos)
+            result.port = authority.substr(portSep + 1);
+        if (result.host.empty())
+            throw std::invalid_argument("Malformed URL: " + url);
+        return result;
+    }
+
+    /// Value of the @c Host header: IPv6 literals re-bracketed, the port only if not 80.
+    std::string hostHeader() const {
+        std::string value = host.find(':') != std::string::npos ? "[" + host + "]" : host;
+        if (port != "80")
+            value += ":" + port;
+        return value;
+    }
+};
+
+/// Closes a socket descriptor on scope exit.
+struct TSocketGuard {
+    int fd = -1;
+    ~TSocketGuard() { if (fd >= 0) ::close(fd); }
+};
+
+/// One HTTP/1.1 range GET over a fresh connection (@c Connection: close).
+inline TFetchStatus::Enum httpGetRange(const THttpUrl& url, std::chrono::milliseconds timeout,
+                                       int64_t offset, size_t length, std::vector<uint8_t>& data,
+                                       int64_t& totalSize, TErrorInfo& error) {
+    auto httpError = [&error, &url](int32_t status, const std::string& message, TFetchStatus::Enum result) {
+        error = TErrorInfo(httpErrorFacility, status, message, url.host + url.path);
+        return result;
+    };
+
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (const int rc = ::getaddrinfo(url.host.c_str(), url.port.c_str(), &hints, &addresses); rc != 0)
+        return httpError(rc, std::string("getaddrinfo: ") + ::gai_strerror(rc), TFetchStatus::Retry);
+    std::unique_ptr<addrinfo, void (*)(addrinfo*)> addressGuard(addresses, ::freeaddrinfo);
+
+    timeval tv{};
+    tv.tv_sec  = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>(timeout.count() % 1000 * 1000);
+
+    TSocketGuard sock;
+    for (addrinfo* ai = addresses; ai; ai = ai->ai_next) {
+        sock.fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (sock.fd < 0)
+            continue;
+        ::setsockopt(sock.fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        ::setsockopt(sock.fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#if defined(SO_NOSIGPIPE)
+        const int one = 1;
+        ::setsockopt(sock.fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        if (::connect(sock.fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        error = systemError("connect");
+        ::close(sock.fd);
+        sock.fd = -1;
+    }
+    if (sock.fd < 0)
+        return TFetchStatus::Retry;
+
+#if defined(MSG_NOSIGNAL)
+    constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+    constexpr int sendFlags = 0;
+#endif
+    const std::string request =
+        "GET " + url.path + " HTTP/1.1\r\n"
+        "Host: " + url.hostHeader() + "\r\n"
+        "Range: bytes=" + std::to_string(offset) + "-" + std::to_string(offset + static_cast<int64_t>(length) - 1) + "\r\n"
+        "User-Agent: avblocks-cpp\r\n"
+        "Connection: close\r\n\r\n";
+    for (size_t sent = 0; sent < request.size(); ) {
+        const ssize_t n = ::send(sock.fd, request.data() + sent, request.size() - sent, sendFlags);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            error = systemError("send");
+            return TFetchStatus::Retry;
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    // Read until the end of the headers; whatever follows is the start of the body.
+    std::string head;
+    size_t headerEnd = std::string::npos;
+    char chunk[16384];
+    while (headerEnd == std::string::npos) {
+        const ssize_t n = ::recv(sock.fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            if (n < 0)
+                error = systemError("recv");
+            else
+                httpError(0, "Connection closed before the response headers", TFetchStatus::Retry);
+            return TFetchStatus::Retry;
+        }
+        head.append(chunk, static_cast<size_t>(n));
+        headerEnd = head.find("\r\n\r\n");
+        if (headerEnd == std::string::npos && head.size() > 65536)
+            return httpError(0, "Response headers too large", TFetchStatus::Fail);
+    }
+
+    int32_t status = 0;
+    if (std::sscanf(head.c_str(), "HTTP/%*d.%*d %d", &status) != 1)
+        return httpError(0, "Malformed HTTP status line", TFetchStatus::Fail);
+
+    int64_t contentLength = -1, rangeFirst = -1, rangeTotal = -1;
+    bool chunked = false;
+    for (size_t line = head.find("\r\n") + 2; line < headerEnd; ) {
+        const size_t next = head.find("\r\n", line);
+        std::string header = head.substr(line, next - line);
+        line = next + 2;
+        const size_t colon = header.find(':');
+        if (colon == std::string::npos)
+            continue;
+        std::string name = header.substr(0, colon);
+        for (char& c : name)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        const char* value = header.c_str() + colon + 1;
+        while (*value == ' ' || *value == '\t')
+            ++value;
+
+        if (name == "content-length") {
+            contentLength = std::strtoll(value, nullptr, 10);
+        } else if (name == "content-range") {
+            long long first = 0, last = 0, total = 0;
+            if (std::sscanf(value, "bytes %lld-%lld/%lld", &first, &last, &total) == 3) {
+                rangeFirst = first;
+                rangeTotal = total;
+            } else if (std::sscanf(value, "bytes %lld-%lld/*", &first, &last) == 2) {
+                rangeFirst = first;
+            }
+        } else if (name == "transfer-encoding") {
+            chunked = std::strstr(value, "chunked") != nullptr;
+        }
+    }
+
+    const std::string reason = "HTTP " + std::to_string(status);
+    if (status == 408 || status == 429 || status >= 500)
+        return httpError(status, reason, TFetchStatus::Retry);
+    if (status == 200 && offset == 0 && contentLength >= 0) {
+        // Server ignored the range but sent the whole object. Usable only if it fits
+        // in one block: later blocks would be refused by the same server.
+        if (contentLength > static_cast<int64_t>(length))
+            return httpError(status, reason + ": server does not support range requests", TFetchStatus::Fail);
+        rangeTotal = contentLength;
+    } else if (status != 206 || rangeFirst != offset) {
+        return httpError(status, status == 200 ? reason + ": server does not support range requests" : reason,
+                         TFetchStatus::Fail);
+    }
+    if (chunked)
+        return httpError(status, "Chunked range responses are not supported", TFetchStatus::Fail);
+
+    if (rangeTotal >= 0)
+        totalSize = rangeTotal;
+    size_t expected = length;
+    if (totalSize >= 0)
+        expected = static_cast<size_t>(std::clamp<int64_t>(totalSize - offset, 0, static_cast<int64_t>(length)));
+    // Without a total ("bytes 0-N/*") only Content-Length tells where a short final range ends.
+    if (contentLength >= 0)
+        expected = std::min(expected, static_cast<size_t>(contentLength));
+
+    data.clear();
+    data.reserve(expected);
+    const size_t bodyStart = headerEnd + 4;
+    data.insert(data.end(), head.begin() + static_cast<std::ptrdiff_t>(bodyStart),
+                head.begin() + static_cast<std::ptrdiff_t>(std::min(head.size(), bodyStart + expected)));
+    while (data.size() < expected) {
+        const ssize_t n = ::recv(sock.fd, chunk, std::min(sizeof(chunk), expected - data.size()), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            if (n < 0)
+                error = systemError("recv");
+            else
+                httpError(status, "Connection closed before the end of the range", TFetchStatus::Retry);
+            return TFetchStatus::Retry;
+        }
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    return TFetchStatus::Ok;
+}
+
+} // namespace detail
+#endif // !_WIN32
+
+/**
+ * Input @c primo::Stream that reads a remote object with HTTP range requests.
+ *
+ * Instead of downloading a source completely before transcoding, the
+ * object is read in @c THttpRangeOptions::blockSize blocks on demand. The
+ * next @c prefetchBlocks blocks are fetched in parallel over several
+ * connections. Fetched blocks stay in an LRU cache, so the seeks a demuxer
+ * makes (an MP4 @c moov at the end, then the samples from the start) do not
+ * download anything twice. @c prefetchTail fetches the last block right
+ * after opening. Transient failures are retried with exponential back-off.
+ *
+ * The built-in client speaks plain HTTP/1.1 over POSIX sockets, one
+ * connection per request. For HTTPS, signed object-store URLs or connection
+ * reuse, pass a @c TRangeFetcher built on the HTTP library of your choice;
+ * caching, prefetching and retries work the same.
+ *
+ * @code
+ * auto in = THttpRangeStream::create("http://storage.local/bucket/in.mp4");
+ * TMediaInfo info;
+ * info.inputs(0).stream(in.get());
+ * info.open();
+ * @endcode
+ */
+class THttpRangeStream final : public detail::TRefCounted<primo::Stream> {
+    struct Block {
+        bool                 ready     = false;
+        bool                 failed    = false;
+        bool                 demanded  = false;
+        uint64_t             lastUse   = 0;
+        std::vector<uint8_t> data;
+    };
+
+    TRangeFetcher     fetcher_;
+    THttpRangeOptions options_;
+    int64_t           size_     = -1;
+    int64_t           position_ = 0;
+    bool              open_     = false;
+
+    std::vector<std::thread>           workers_;
+    mutable std::mutex                 mutex_;
+    std::condition_variable            workCv_;
+    std::condition_variable            readyCv_;
+    std::unordered_map<int64_t, Block> cache_;
+    std::deque<int64_t>                queue_;
+    uint64_t                           clock_    = 0;
+    int64_t                            cursorBlock_ = 0;
+    bool                               stopping_ = false;
+    TErrorInfo                         error_;
+    THttpRangeStats                    stats_;
+
+    THttpRangeStream(TRangeFetcher fetcher, const THttpRangeOptions& options)
+        : fetcher_(std::move(fetcher)), options_(options) {
+        options_.blockSize      = std::max<size_t>(options_.blockSize, 4096);
+        options_.prefetchBlocks = std::max<int32_t>(options_.prefetchBlocks, 0);
+        options_.connections    = std::max<int32_t>(options_.connections, 1);
+        options_.cacheBlocks    = std::max<int32_t>(options_.cacheBlocks, options_.prefetchBlocks + 2);
+    }
+
+    ~THttpRangeStream() override { close(); }
+
+    int64_t blockCount() const {
+        return (size_ + static_cast<int64_t>(options_.blockSize) - 1) / static_cast<int64_t>(options_.blockSize);
+    }
+
+    /// Fetches block @p index with retries. Called without the lock.
+    TFetchStatus::Enum fetch(int64_t index, std::vector<uint8_t>& data, int64_t& totalSize, TErrorInfo& error) {
+        const int64_t offset = index * static_cast<int64_t>(options_.blockSize);
+        auto delay = options_.retryDelay;
+        for (int32_t attempt = 0; ; ++attempt) {
+            const TFetchStatus::Enum status = fetcher_(offset, options_.blockSize, data, totalSize, error);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++stats_.requests;
+                if (status == TFetchStatus::Ok)
+                    stats_.bytesFetched += static_cast<int64_t>(data.size());
+                else if (status == TFetchStatus::Retry && attempt < options_.retries)
+                    ++stats_.retries;
+            }
+            if (status != TFetchStatus::Retry || attempt >= options_.retries)
+                return status;
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (workCv_.wait_for(lock, delay, [this] { return stopping_; }))
+                return TFetchStatus::Fail;
+            delay *= 2;
+        }
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            workCv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_)
+                return;
+            const int64_t index = queue_.front();
+            queue_.pop_front();
+            lock.unlock();
+
+            std::vector<uint8_t> data;
+            TErrorInfo error;
+            int64_t total = size_;
+            const TFetchStatus::Enum status = fetch(index, data, total, error);
+
+            lock.lock();
+            auto it = cache_.find(index);
+            if (it == cache_.end())
+                continue;
+            if (status == TFetchStatus::Ok) {
+                it->second.ready = true;
+                it->second.data  = std::move(data);
+                evict();
+            } else if (it->second.demanded) {
+                it->second.failed = true;
+                error_ = std::move(error);
+            } else {
+                cache_.erase(it);   // failed prefetch: a later read retries on demand
+            }
+            readyCv_.notify_all();
+        }
+    }
+
+    /// Requests block @p index unless it is cached or in flight. Caller holds the lock.
+    void request(int64_t index, bool demand) {
+        if (index < 0 || index >= blockCount())
+            return;
+        auto [it, inserted] = cache_.try_emplace(index);
+        if (demand)
+            it->second.demanded = true;
+        if (!inserted)
+            return;
+        it->second.lastUse = ++clock_;
+        if (demand)
+            queue_.push_front(index);
+        else
+            queue_.push_back(index);
+        workCv_.notify_one();
+    }
+
+    /// Drops least recently used blocks outside the read-ahead window. Caller holds the lock.
+    void evict() {
+        for (;;) {
+            int64_t readyCount = 0;
+            auto victim = cache_.end();
+            for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+                if (!it->second.ready)
+                    continue;
+                ++readyCount;
+                const bool inWindow = it->first >= cursorBlock_ &&
+                                      it->first <= cursorBlock_ + options_.prefetchBlocks;
+                if (!inWindow && (victim == cache_.end() || it->second.lastUse < victim->second.lastUse))
+                    victim = it;
+            }
+            if (readyCount <= options_.cacheBlocks || victim == cache_.end())
+                return;
+            cache_.erase(victim);
+        }
+    }
+
+public:
+#if !defined(_WIN32)
+    /// Creates a stream for the plain-HTTP @p url using the built-in client.
+    /// Throws @c std::invalid_argument for other schemes.
+    static primo::ref<THttpRangeStream> create(const std::string& url, const THttpRangeOptions& options = {}) {
+        const detail::THttpUrl parsed = detail::THttpUrl::parse(url);
+        const auto timeout = options.timeout;
+        return create([parsed, timeout](int64_t offset, size_t length, std::vector<uint8_t>& data,
+                                        int64_t& totalSize, TErrorInfo& error) {
+            return detail::httpGetRange(parsed, timeout, offset, length, data, totalSize, error);
+        }, options);
+    }
+#endif
+
+    /// Creates a stream that reads through @p fetcher.
+    static primo::ref<THttpRangeStream> create(TRangeFetcher fetcher, const THttpRangeOptions& options = {}) {
+        return primo::ref<THttpRangeStream>(new THttpRangeStream(std::move(fetcher), options));
+    }
+
+    bool_t isOpen() const override { return open_; }
+
+    /// Fetches the first block (which also reports the object size) and starts the fetch threads.
+    bool_t open() override {
+        if (open_) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            position_ = 0;
+            return TRUE;
+        }
+
+        std::vector<uint8_t> first;
+        TErrorInfo error;
+        int64_t total = -1;
+        stats_    = THttpRangeStats{};
+        stopping_ = false;
+        if (fetch(0, first, total, error) != TFetchStatus::Ok) {
+            error_ = std::move(error);
+            return FALSE;
+        }
+        if (total < 0) {
+            // Without a reported total (Content-Range "bytes 0-N/*") only a response shorter
+            // than a block tells the size; anything else would silently truncate the input.
+            if (first.size() >= options_.blockSize) {
+                error_ = TErrorInfo(httpErrorFacility, 0,
+                                    "Object size unknown: the range response did not report a total");
+                return FALSE;
+            }
+            total = static_cast<int64_t>(first.size());
+        }
+        size_ = total;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Block& block = cache_[0];
+            block.ready   = true;
+            block.lastUse = ++clock_;
+            block.data    = std::move(first);
+            position_     = 0;
+            cursorBlock_  = 0;
+            for (int32_t i = 0; i < options_.connections; ++i)
+                workers_.emplace_back([this] { workerLoop(); });
+            if (options_.prefetchTail)
+                request(blockCount() - 1, false);
+            for (int32_t i = 1; i <= options_.prefetchBlocks; ++i)
+                request(i, false);
+        }
+        open_ = true;
+        return TRUE;
+    }
+
+    /// Stops the fetch threads and drops the cache.
+    void close() override {
+        if (!open_)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        workCv_.notify_all();
+        for (auto& worker : workers_)
+            worker.join();
+        workers_.clear();
+        cache_.clear();
+        queue_.clear();
+        open_ = false;
+    }
+
+    bool_t canRead()  const override { return TRUE; }
+    bool_t canWrite() const override { return FALSE; }
+    bool_t canSeek()  const override { return TRUE; }
+
+    bool_t read(void* buffer, int32_t bufferSize, int32_t* totalRead) override {
+        if (!open_ || bufferSize < 0 || !totalRead)
+            return FALSE;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        const auto blockSize = static_cast<int64_t>(options_.blockSize);
+        const int64_t want   = std::min<int64_t>(bufferSize, std::max<int64_t>(size_ - position_, 0));
+        auto*   dst    = static_cast<uint8_t*>(buffer);
+        int64_t copied = 0;
+        bool    waited = false;
+        std::chrono::steady_clock::time_point waitStart;
+
+        while (copied < want) {
+            const int64_t index = position_ / blockSize;
+            cursorBlock_ = index;
+            request(index, true);
+            for (int32_t i = 1; i <= options_.prefetchBlocks; ++i)
+                request(index + i, false);
+
+            Block* block = &cache_[index];
+            if (!block->ready && !block->failed) {
+                if (!waited) {
+                    waited    = true;
+                    waitStart = std::chrono::steady_clock::now();
+                }
+                readyCv_.wait(lock, [this, index] {
+                    auto it = cache_.find(index);
+                    return it == cache_.end() || it->second.ready || it->second.failed;
+                });
+                continue;   // re-check: the block may have been dropped or failed
+            }
+            if (block->failed) {
+                cache_.erase(index);   // allow a later read to try again
+                break;
+            }
+
+            block->lastUse = ++clock_;
+            const int64_t skip  = position_ - index * blockSize;
+            const int64_t count = std::min<int64_t>(want - copied, static_cast<int64_t>(block->data.size()) - skip);
+            if (count <= 0)
+                break;   // object shorter than reported
+            std::memcpy(dst + copied, block->data.data() + skip, static_cast<size_t>(count));
+            copied    += count;
+            position_ += count;
+        }
+
+        if (waited) {
+            ++stats_.stalls;
+            stats_.stallTime += std::chrono::steady_clock::now() - waitStart;
+        } else if (copied > 0) {
+            ++stats_.hits;
+        }
+        *totalRead = static_cast<int32_t>(copied);
+        return copied == want ? TRUE : FALSE;
+    }
+
+    bool_t write(const void*, int32_t) override { return FALSE; }
+
+    int64_t size() const override { return size_; }
+
+    int64_t position() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return position_;
+    }
+
+    bool_t seek(int64_t position) override {
+        if (!open_ || position < 0 || position > size_)
+            return FALSE;
+        std::lock_guard<std::mutex> lock(mutex_);
+        position_ = position;
+        return TRUE;
+    }
+
+    THttpRangeStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    /// Error of the last request that failed for good.
+    TErrorInfo error() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_;
+    }
+};
+
+} // namespace primo::avblocks::modern
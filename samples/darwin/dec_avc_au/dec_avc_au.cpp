@@ -1,4 +1,5 @@
 #include <primo/avblocks/avb++.h>
+#include <primo/avblocks/avb++io.h>
 
 #include <print>
 #include <iomanip>
@@ -79,12 +80,12 @@ bool decode(Options& opt)
             ostringstream auPath;
             auPath << opt.input_dir << "/au_" << setw(4) << setfill('0') << i << ".h264";
 
-            vector<uint8_t> auData = readFileBytes(auPath.str().c_str());
-            if (auData.empty())
+            // Map the AU file; the sample points straight into the mapping
+            TMappedFile auFile;
+            if (!auFile.tryOpen(auPath.str()) || auFile.size() == 0)
                 break;
 
-            TMediaSample sample;
-            sample.buffer(TMediaBuffer().attach(auData.data(), auData.size()));
+            TMediaSample sample = auFile.sample();
 
             if (!transcoder.push(0, sample))
             {
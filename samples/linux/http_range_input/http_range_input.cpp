@@ -0,0 +1,324 @@
+#include <primo/avblocks/avb++.h>
+#include <primo/avblocks/avb++io.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "options.h"
+#include "util.h"
+
+using namespace std;
+using namespace primo::codecs;
+using namespace primo::avblocks::modern;
+
+// ---- Loopback HTTP server ---------------------------------------------------
+
+/*
+ * Minimal HTTP/1.1 server on 127.0.0.1 that stands in for object storage.
+ * It serves one object with range requests (206 Partial Content), answers
+ * any other path with 404, and answers the first `failures` requests with
+ * 503 so the client's retries can be observed. One request per connection.
+ */
+class LoopbackServer
+{
+public:
+    LoopbackServer(vector<uint8_t> object, string path, int failures)
+        : object_(std::move(object)), path_(std::move(path)), failuresLeft_(failures) {}
+
+    ~LoopbackServer() { stop(); }
+
+    bool start()
+    {
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0)
+            return false;
+
+        const int one = 1;
+        ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port        = 0;   // any free port
+        socklen_t length = sizeof(addr);
+        if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listenFd_, 64) != 0 ||
+            ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &length) != 0)
+        {
+            return false;
+        }
+
+        port_ = ntohs(addr.sin_port);
+        acceptThread_ = thread([this] { acceptLoop(); });
+        return true;
+    }
+
+    void stop()
+    {
+        if (listenFd_ < 0)
+            return;
+
+        stopping_ = true;
+        ::shutdown(listenFd_, SHUT_RDWR);   // wakes accept()
+        if (acceptThread_.joinable())
+            acceptThread_.join();
+        for (auto& handler : handlers_)
+            handler.join();
+        handlers_.clear();
+        ::close(listenFd_);
+        listenFd_ = -1;
+    }
+
+    int port() const { return port_; }
+    int requests() const { return requests_; }
+
+private:
+    vector<uint8_t> object_;
+    string          path_;
+    atomic<int>     failuresLeft_;
+    atomic<int>     requests_{0};
+    atomic<bool>    stopping_{false};
+    int             listenFd_ = -1;
+    int             port_ = 0;
+    thread          acceptThread_;
+    vector<thread>  handlers_;
+
+    void acceptLoop()
+    {
+        while (!stopping_)
+        {
+            const int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+            handlers_.emplace_back([this, fd] { serve(fd); ::close(fd); });
+        }
+    }
+
+    static bool sendAll(int fd, const void* data, size_t size)
+    {
+        auto* p = static_cast<const uint8_t*>(data);
+        while (size > 0)
+        {
+            const ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            p    += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static void sendStatus(int fd, const char* status, const string& extraHeaders = string())
+    {
+        string response = string("HTTP/1.1 ") + status + "\r\n" + extraHeaders +
+                          "Content-Length: 0\r\nConnection: close\r\n\r\n";
+        sendAll(fd, response.data(), response.size());
+    }
+
+    void serve(int fd)
+    {
+        string request;
+        char chunk[4096];
+        while (request.find("\r\n\r\n") == string::npos && request.size() < 16384)
+        {
+            const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                return;
+            request.append(chunk, static_cast<size_t>(n));
+        }
+        ++requests_;
+
+        char method[16] = {}, target[1024] = {};
+        if (sscanf(request.c_str(), "%15s %1023s", method, target) != 2 || strcmp(method, "GET") != 0)
+        {
+            sendStatus(fd, "400 Bad Request");
+            return;
+        }
+        if (path_ != target)
+        {
+            sendStatus(fd, "404 Not Found");
+            return;
+        }
+        if (failuresLeft_.fetch_sub(1) > 0)
+        {
+            sendStatus(fd, "503 Service Unavailable");
+            return;
+        }
+
+        const int64_t size = static_cast<int64_t>(object_.size());
+        long long first = 0, last = size - 1;
+        if (const char* range = strcasestr(request.c_str(), "\r\nRange: bytes="))
+            sscanf(range + strlen("\r\nRange: bytes="), "%lld-%lld", &first, &last);
+        if (first >= size)
+        {
+            sendStatus(fd, "416 Range Not Satisfiable", "Content-Range: bytes */" + to_string(size) + "\r\n");
+            return;
+        }
+        last = min<long long>(last, size - 1);
+
+        const string headers =
+            "HTTP/1.1 206 Partial Content\r\n"
+            "Content-Range: bytes " + to_string(first) + "-" + to_string(last) + "/" + to_string(size) + "\r\n"
+            "Content-Length: " + to_string(last - first + 1) + "\r\n"
+            "Connection: close\r\n\r\n";
+        if (sendAll(fd, headers.data(), headers.size()))
+            sendAll(fd, object_.data() + first, static_cast<size_t>(last - first + 1));
+    }
+};
+
+// ---- Checks ----------------------------------------------------------------
+
+static bool report(const char* check, bool passed)
+{
+    cout << (passed ? "PASS " : "FAIL ") << check << endl;
+    return passed;
+}
+
+static bool readAt(primo::Stream* stream, int64_t position, uint8_t* buffer, int32_t size)
+{
+    if (!stream->seek(position))
+        return false;
+
+    int32_t total = 0;
+    while (total < size)
+    {
+        int32_t n = 0;
+        if (!stream->read(buffer + total, size - total, &n) || n == 0)
+            return false;
+        total += n;
+    }
+    return true;
+}
+
+// Reads the tail first, then the whole object from the start: the access pattern
+// of an MP4 demuxer when the moov atom is stored at the end of the file.
+static bool checkTailThenStart(THttpRangeStream* stream, const vector<uint8_t>& object)
+{
+    const int32_t tail = static_cast<int32_t>(min<size_t>(object.size(), 64 * 1024));
+    vector<uint8_t> buffer(object.size());
+
+    const int64_t tailStart = static_cast<int64_t>(object.size()) - tail;
+    if (!readAt(stream, tailStart, buffer.data(), tail) ||
+        memcmp(buffer.data(), object.data() + tailStart, static_cast<size_t>(tail)) != 0)
+    {
+        return false;
+    }
+
+    for (size_t offset = 0; offset < object.size(); offset += 1 << 20)
+    {
+        const int32_t size = static_cast<int32_t>(min<size_t>(object.size() - offset, 1 << 20));
+        if (!readAt(stream, static_cast<int64_t>(offset), buffer.data() + offset, size))
+            return false;
+    }
+    return memcmp(buffer.data(), object.data(), object.size()) == 0;
+}
+
+static void printStats(const THttpRangeStats& stats)
+{
+    cout << "requests: " << stats.requests
+         << ", retries: " << stats.retries
+         << ", bytes fetched: " << stats.bytesFetched
+         << ", read hits: " << stats.hits
+         << ", read stalls: " << stats.stalls
+         << " (" << chrono::duration_cast<chrono::milliseconds>(stats.stallTime).count() << " ms)"
+         << endl;
+}
+
+bool rangeInput(Options& opt)
+{
+    vector<uint8_t> object = readFileBytes(opt.inputFile.c_str());
+    if (object.empty())
+    {
+        cout << "Cannot read input file: " << opt.inputFile << endl;
+        return false;
+    }
+
+    LoopbackServer server(object, "/bucket/input.mp4", opt.failures);
+    if (!server.start())
+    {
+        cout << "Cannot start the loopback HTTP server" << endl;
+        return false;
+    }
+    const string base = "http://127.0.0.1:" + to_string(server.port());
+    cout << "serving " << opt.inputFile << " at " << base << "/bucket/input.mp4" << endl;
+
+    THttpRangeOptions options;
+    options.blockSize   = 256 * 1024;
+    options.cacheBlocks = 8;
+    options.retryDelay  = chrono::milliseconds(20);
+
+    bool passed = true;
+    {
+        auto stream = THttpRangeStream::create(base + "/bucket/input.mp4", options);
+        if (!stream->open())
+        {
+            printError("HTTP range open", stream->error());
+            return false;
+        }
+
+        passed &= report("size matches the served object", stream->size() == static_cast<int64_t>(object.size()));
+        passed &= report("tail seek, then read from the start", checkTailThenStart(stream.get(), object));
+
+        const THttpRangeStats stats = stream->stats();
+        printStats(stats);
+        passed &= report("503 responses were retried", stats.retries == opt.failures);
+
+        // Let the demuxer seek through the same stream.
+        TMediaInfo info;
+        info.inputs(0).stream(stream.get());
+        if (info.tryOpen())
+        {
+            cout << "streams: " << info.outputs(0).pins().count() << endl;
+            printStats(stream->stats());
+        }
+        else
+        {
+            printError("MediaInfo open", info.error());
+            passed = report("MediaInfo over HTTP", false);
+        }
+        stream->close();
+    }
+
+    {
+        auto missing = THttpRangeStream::create(base + "/bucket/missing.mp4", options);
+        const bool failed = !missing->open();
+        if (failed)
+            printError("missing object", missing->error());
+        passed &= report("404 fails open() without retries", failed && missing->error().facility() == httpErrorFacility &&
+                                                               missing->error().code() == 404 &&
+                                                               missing->stats().retries == 0);
+    }
+
+    cout << "server handled " << server.requests() << " requests" << endl;
+    return passed;
+}
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    switch (prepareOptions(opt, argc, argv))
+    {
+        case Command: return 0;
+        case Error:   return 1;
+        case Parsed:  break;
+    }
+
+    TLibrary library;
+    return rangeInput(opt) ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#include <string>
+#include <iostream>
+#include <sstream>
+
+#include "options.h"
+#include "program_options.h"
+#include "util.h"
+
+using namespace std;
+using namespace primo::program_options;
+
+void setDefaultOptions(Options& opt)
+{
+    opt.inputFile = getExeDir() + "/../../assets/mov/big_buck_bunny_trailer.mp4";
+    opt.failures = 2;
+    cout << "Using default input file.\n";
+}
+
+void help(OptionsConfig<char>& optcfg)
+{
+    cout << "http_range_input --input <avfile> [--failures <count>]" << endl;
+    doHelp(cout, optcfg);
+}
+
+ErrorCodes prepareOptions(Options& opt, int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        setDefaultOptions(opt);
+        cout << "Using defaults:\n";
+        cout << " --input " << opt.inputFile;
+        cout << " --failures " << opt.failures;
+        cout << endl;
+        return Parsed;
+    }
+
+    OptionsConfig<char> optcfg;
+    optcfg.addOptions()
+    ("help,h", opt.help, "")
+    ("input,i", opt.inputFile, string(), "file served over loopback HTTP; if no input is specified a default input file is used.")
+    ("failures,f", opt.failures, 2, "number of range requests the server answers with 503 before serving data.");
+
+    try
+    {
+        scanArgv(optcfg, argc, argv);
+    }
+    catch (ParseFailure<char>& ex)
+    {
+        cout << ex.message() << endl;
+        help(optcfg);
+        return Error;
+    }
+
+    if (opt.help)
+    {
+        help(optcfg);
+        return Command;
+    }
+
+    return Parsed;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+enum ErrorCodes { Parsed = 0, Error, Command };
+
+struct Options {
+    Options() : failures(2), help(false) {}
+    std::string inputFile;
+    int failures;
+    bool help;
+};
+
+ErrorCodes prepareOptions(Options& opt, int argc, char* argv[]);
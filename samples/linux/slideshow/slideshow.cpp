@@ -10,7 +10,7 @@
 using namespace primo::codecs;
 using namespace primo::avblocks::modern;
 
-static TMediaBuffer loadImageFile(const char* filename)
+static TMediaBuffer loadImageFile(TMediaBufferPool& pool, const char* filename)
 {
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
     if (!file)
@@ -22,7 +22,7 @@ static TMediaBuffer loadImageFile(const char* filename)
     auto imgsize = static_cast<int32_t>(file.tellg());
     file.seekg(0);
 
-    TMediaBuffer buffer(imgsize);
+    TMediaBuffer buffer = pool.acquire(imgsize);
     file.read(reinterpret_cast<char*>(buffer.start()), imgsize);
     buffer.setData(0, static_cast<int32_t>(file.gcount()));
 
@@ -64,12 +64,15 @@ bool slideshow(const Options& opt)
 
         transcoder.open();
 
+        // Image buffers are recycled once the transcoder releases them
+        TMediaBufferPool pool;
+
         TMediaSample sample;
         for (int i = 0; i < imageCount; ++i)
         {
             auto imagePath = std::format("{}/cube{:04d}.jpeg", opt.input_dir, i);
 
-            TMediaBuffer buffer = loadImageFile(imagePath.c_str());
+            TMediaBuffer buffer = loadImageFile(pool, imagePath.c_str());
             sample.buffer(std::move(buffer));
             sample.startTime(i / inputFramerate);
 
@@ -74,12 +74,12 @@ bool decode(Options& opt)
             wostringstream auPath;
             auPath << opt.input_dir << L"/au_" << setw(4) << setfill(L'0') << i << L".h265";
 
-            vector<uint8_t> auData = readFileBytes(auPath.str().c_str());
-            if (auData.empty())
+            // Map the AU file; the sample points straight into the mapping
+            TMappedFile auFile;
+            if (!auFile.tryOpen(auPath.str()) || auFile.size() == 0)
                 break;
 
-            TMediaSample sample;
-            sample.buffer(TMediaBuffer().attach(auData.data(), auData.size()));
+            TMediaSample sample = auFile.sample();
 
             if (!transcoder.push(0, sample))
             {
@@ -28,3 +28,4 @@
 #include <primo/platform/reference++.h>
 #include <primo/platform/error_facility.h>
 #include <primo/avblocks/avb++.h>
+#include <primo/avblocks/avb++io.h>
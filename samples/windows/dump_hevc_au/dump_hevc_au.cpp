@@ -90,33 +90,34 @@ static void print_nalu_header(const uint8_t* data)
     wcout << left << L"  " << setw(12) << nal_unit_type(*data) << L"\n";
 }
 
-static void print_nalus(TMediaBuffer& buffer)
+static void print_nalus(TMediaBufferView buffer)
 {
-    while (buffer.dataSize() > 1)
+    const uint8_t* data = buffer.data();
+    const uint8_t* end  = data + buffer.dataSize();
+
+    while (end - data > 1)
     {
-        int32_t        dataOffset = buffer.dataOffset();
-        int32_t        dataSize   = buffer.dataSize();
-        const uint8_t* data       = buffer.data();
+        ptrdiff_t dataSize = end - data;
 
         if (dataSize >= 3 && data[0] == 0x00 && data[1] == 0x00 && data[2] == 0x01)
         {
             print_nalu_header(data + 3);
-            buffer.setData(dataOffset + 3, dataSize - 3);
+            data += 3;
         }
         else if (dataSize >= 4 && data[0] == 0x00 && data[1] == 0x00 &&
                  data[2] == 0x00 && data[3] == 0x01)
         {
             print_nalu_header(data + 4);
-            buffer.setData(dataOffset + 4, dataSize - 4);
+            data += 4;
         }
         else
         {
-            buffer.setData(dataOffset + 1, dataSize - 1);
+            ++data;
         }
     }
 }
 
-static void write_au_file(const wstring& outputDir, int au_index, TMediaBuffer& buffer)
+static void write_au_file(const wstring& outputDir, int au_index, TMediaBufferView buffer)
 {
     wostringstream name;
     name << outputDir << L"/au_" << setw(4) << setfill(L'0') << au_index << L".h265";
@@ -156,7 +157,7 @@ bool parse_h265_stream(const wstring& inputFile, const wstring& outputDir)
         int au_index = 0;
         while (transcoder.pull(outputIndex, accessUnit))
         {
-            auto buf = accessUnit.buffer();
+            auto buf = accessUnit.bufferView();
             wcout << L"AU #" << au_index << L", " << buf.dataSize() << L" bytes" << endl;
             write_au_file(outputDir, au_index, buf);
             print_nalus(buf);
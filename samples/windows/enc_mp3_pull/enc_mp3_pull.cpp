@@ -45,7 +45,7 @@ bool encode(const Options& opt)
 
         while (transcoder.pull(outputIndex, sample))
         {
-            auto buf = sample.buffer();
+            auto buf = sample.bufferView();
             outfile.write(reinterpret_cast<const char*>(buf.data()), buf.dataSize());
         }
 
@@ -14,7 +14,7 @@
 using namespace primo::codecs;
 using namespace primo::avblocks::modern;
 
-static primo::avblocks::modern::TMediaBuffer loadImageFile(const wchar_t* filename)
+static primo::avblocks::modern::TMediaBuffer loadImageFile(primo::avblocks::modern::TMediaBufferPool& pool, const wchar_t* filename)
 {
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
     if (!file)
@@ -26,7 +26,7 @@ static primo::avblocks::modern::TMediaBuffer loadImageFile(const wchar_t* filena
     auto imgsize = static_cast<int32_t>(file.tellg());
     file.seekg(0);
 
-    primo::avblocks::modern::TMediaBuffer buffer(imgsize);
+    primo::avblocks::modern::TMediaBuffer buffer = pool.acquire(imgsize);
     file.read(reinterpret_cast<char*>(buffer.start()), imgsize);
     buffer.setData(0, static_cast<int32_t>(file.gcount()));
 
@@ -68,6 +68,9 @@ bool slideshow(const Options& opt)
 
         transcoder.open();
 
+        // Image buffers are recycled once the transcoder releases them
+        TMediaBufferPool pool;
+
         TMediaSample sample;
         for (int i = 0; i < imageCount; ++i)
         {
@@ -78,7 +81,7 @@ bool slideshow(const Options& opt)
             pathStream << L".jpeg";
             std::wstring imagePath = pathStream.str();
 
-            TMediaBuffer buffer = loadImageFile(imagePath.c_str());
+            TMediaBuffer buffer = loadImageFile(pool, imagePath.c_str());
             sample.buffer(std::move(buffer));
             sample.startTime(i / inputFramerate);
 